@@ -12,9 +12,13 @@
 //  OpenGL Super Bible (Waite Group Press)
 //  And many more...
 
+#include <cstdio>
+#include <cstring>
 #include <iostream>
 #include "App.h"
+#include "BudgetController.h"
 #include "Landscape.h"
+#include "MeshRenderer.h"
 #include "Utility.h"
 
 void App::Init()
@@ -97,6 +101,9 @@ void App::Shutdown()
 
     std::cout << "Quitting." << std::endl;
     std::cout << "Average FPS: " << m_AvgFrames << std::endl;
+    std::cout << "TriTreeNode high-water mark: " << gLand.GetTriPool().GetHighWaterMark()
+              << " (pool capacity " << gLand.GetTriPool().GetCapacity() << ")" << std::endl;
+    gController.PrintStatistics();
 }
 
 void App::Loop()
@@ -127,6 +134,20 @@ void App::Loop()
         IdleFunction();
         RenderScene();
 
+        // Show how much of the tessellation time budget the frame used, and how many patches the geometry cache drew.
+        char title[160] = "ROAM Terrain View";
+        size_t length = strlen(title);
+
+        if (gTimeBudget > 0)
+            length += snprintf(title + length, sizeof(title) - length, " - tessellation %d%% of %d us",
+                               (int) (gBudgetUsage * 100.0f), gTimeBudget);
+
+        if (gRenderer.GetCacheLookups() > 0)
+            snprintf(title + length, sizeof(title) - length, " - geometry cache %d%% hits",
+                     gRenderer.GetCacheHits() * 100 / gRenderer.GetCacheLookups());
+
+        SDL_SetWindowTitle(m_Window, title);
+
         // Copy image to window
         SDL_GL_SwapWindow(m_Window);
     }
@@ -180,6 +201,27 @@ void App::SDLKeyDown(SDL_Keysym *keysym)
         case SDLK_r:
             KeyDrawFrustumToggle();
             break;
+        case SDLK_e:
+            KeyEngineToggle();
+            break;
+        case SDLK_v:
+            KeyRenderPathToggle();
+            break;
+        case SDLK_g:
+            KeyGeometryCacheToggle();
+            break;
+        case SDLK_p:
+            KeyTessellateOrderToggle();
+            break;
+        case SDLK_m:
+            KeyErrorMetricToggle();
+            break;
+        case SDLK_c:
+            KeyControllerToggle();
+            break;
+        case SDLK_x:
+            KeyCrater();
+            break;
 
         case SDLK_0:
             KeyMoreDetail();
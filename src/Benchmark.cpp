@@ -0,0 +1,1824 @@
+//  Benchmark.cpp
+//  Bryan Turner (original version), Rodrigo Verdiani (SDL version)
+//
+//  Parts of the code in this file were borrowed from numerous public sources &
+//  literature.  I reserve NO rights to this code and give a hearty thank-you to all the
+//  excellent sources used in this project.  These include, but are not limited to:
+//
+//  Longbow Digital Arts Programming Forum (www.LongbowDigitalArts.com)
+//  Gamasutra Features (www.Gamasutra.com)
+//  GameDev References (www.GameDev.net)
+//  C. Cookson's ROAM implementation (C.J.Cookson@dcs.warwick.ac.uk OR cjcookson@hotmail.com)
+//  OpenGL Super Bible (Waite Group Press)
+//  And many more...
+
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "Benchmark.h"
+#include "BudgetController.h"
+#include "CompactLandscape.h"
+#include "Landscape.h"
+#include "MeshExtractor.h"
+#include "MeshRenderer.h"
+#include "NormalMap.h"
+#include "PipelinedLandscape.h"
+#include "SplitMergeLandscape.h"
+#include "ThreadPool.h"
+#include "Utility.h"
+#include "VarianceBuilder.h"
+
+typedef std::chrono::high_resolution_clock BenchClock;
+
+// Landscapes used by the benchmarks (the second one is the pipeline's back buffer)
+static Landscape gBenchLand;
+static Landscape gBenchLandBack;
+
+static double benchMilliseconds(BenchClock::time_point start, BenchClock::time_point end)
+{
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+// Load the height map and build a landscape, just like roamInit() without the GL setup.
+static Landscape *benchInitLandscape()
+{
+    loadTerrain(MAP_SIZE, &gHeightMap);
+
+    gBenchLand.Init(gHeightMap);
+
+    return &gBenchLand;
+}
+
+// Place the camera on the same circle around the map center as the animated follow mode.
+static void benchSetCamera(float angle)
+{
+    gViewPosition[0] = ((GLfloat) MAP_SIZE / 4.f) + ((sinf(angle * M_PI / 180.f) + 1.f) * ((GLfloat) MAP_SIZE / 4.f));
+    gViewPosition[2] = ((GLfloat) MAP_SIZE / 4.f) + ((cosf(angle * M_PI / 180.f) + 1.f) * ((GLfloat) MAP_SIZE / 4.f));
+    gViewPosition[1] = (MULT_SCALE * gHeightMap[(int) gViewPosition[0] + ((int) gViewPosition[2] * MAP_SIZE)]) + 4.0f;
+
+    gClipAngle = -angle;
+}
+
+// Let the frame variance settle on gDesiredTris before measuring anything.
+static void benchSettleVariance(Landscape *land)
+{
+    for (int frame = 0; frame < 200; frame++)
+    {
+        benchSetCamera(0);
+        land->Update();
+        land->AdjustFrameVariance();
+    }
+}
+
+// Walk a TriTreeNode tree down to the leaves, the way Patch::RecursRender does, without any GL calls.
+static unsigned int benchCountLeaves(TriTreeNode *tri, int leftX, int leftY, int rightX, int rightY, int apexX, int apexY,
+                                     unsigned int *heightSum)
+{
+    if (tri->LeftChild)
+    {
+        int centerX = (leftX + rightX) >> 1;
+        int centerY = (leftY + rightY) >> 1;
+
+        return benchCountLeaves(tri->LeftChild, apexX, apexY, leftX, leftY, centerX, centerY, heightSum) +
+               benchCountLeaves(tri->RightChild, rightX, rightY, apexX, apexY, centerX, centerY, heightSum);
+    }
+
+    *heightSum += gHeightMap[(leftY * MAP_SIZE) + leftX] + gHeightMap[(rightY * MAP_SIZE) + rightX] +
+                  gHeightMap[(apexY * MAP_SIZE) + apexX];
+
+    return 1;
+}
+
+static unsigned int benchCountLeaves(Landscape *land, unsigned int *heightSum)
+{
+    unsigned int leaves = 0;
+
+    for (int y = 0; y < NUM_PATCHES_PER_SIDE; y++)
+    {
+        for (int x = 0; x < NUM_PATCHES_PER_SIDE; x++)
+        {
+            Patch *patch = land->GetPatch(x, y);
+            if (!patch->isVisibile())
+                continue;
+
+            int worldX = patch->GetWorldX();
+            int worldY = patch->GetWorldY();
+
+            leaves += benchCountLeaves(patch->GetBaseLeft(), worldX, worldY + PATCH_SIZE, worldX + PATCH_SIZE, worldY,
+                                       worldX, worldY, heightSum);
+            leaves += benchCountLeaves(patch->GetBaseRight(), worldX + PATCH_SIZE, worldY, worldX, worldY + PATCH_SIZE,
+                                       worldX + PATCH_SIZE, worldY + PATCH_SIZE, heightSum);
+        }
+    }
+
+    return leaves;
+}
+
+// FNV-1a hash of the leaf corners of a TriTreeNode tree, in rendering order.
+static unsigned int benchHashLeaves(TriTreeNode *tri, int leftX, int leftY, int rightX, int rightY, int apexX, int apexY,
+                                    unsigned int hash)
+{
+    if (tri->LeftChild)
+    {
+        int centerX = (leftX + rightX) >> 1;
+        int centerY = (leftY + rightY) >> 1;
+
+        hash = benchHashLeaves(tri->LeftChild, apexX, apexY, leftX, leftY, centerX, centerY, hash);
+        return benchHashLeaves(tri->RightChild, rightX, rightY, apexX, apexY, centerX, centerY, hash);
+    }
+
+    const int corners[6] = {leftX, leftY, rightX, rightY, apexX, apexY};
+    for (int corner : corners)
+        hash = (hash ^ (unsigned int) corner) * 16777619u;
+
+    return hash;
+}
+
+// Hash of the whole mesh: two landscapes with the same hash have the same leaves in the same order.
+static unsigned int benchHashMesh(Landscape *land)
+{
+    unsigned int hash = 2166136261u;
+
+    for (int y = 0; y < NUM_PATCHES_PER_SIDE; y++)
+    {
+        for (int x = 0; x < NUM_PATCHES_PER_SIDE; x++)
+        {
+            Patch *patch = land->GetPatch(x, y);
+            if (!patch->isVisibile())
+                continue;
+
+            int worldX = patch->GetWorldX();
+            int worldY = patch->GetWorldY();
+
+            hash = benchHashLeaves(patch->GetBaseLeft(), worldX, worldY + PATCH_SIZE, worldX + PATCH_SIZE, worldY,
+                                   worldX, worldY, hash);
+            hash = benchHashLeaves(patch->GetBaseRight(), worldX + PATCH_SIZE, worldY, worldX, worldY + PATCH_SIZE,
+                                   worldX + PATCH_SIZE, worldY + PATCH_SIZE, hash);
+        }
+    }
+
+    return hash;
+}
+
+// Compare the pointer based TriTreeNode against the index based CompactTriNode.
+// Both layouts are driven along the same camera path with the same frame variance.
+static void benchLayout(int frames)
+{
+    Landscape *land = benchInitLandscape();
+    CompactLandscape compact(land);
+
+    compact.SetMaxNodes((uint32_t) gMaxNodes);
+    benchSettleVariance(land);
+
+    std::vector<unsigned int> leafCounts(frames), heightSums(frames);
+    double tessMs[2] = {0, 0}, walkMs[2] = {0, 0};
+    double numNodes[2] = {0, 0};
+    bool identical = true;
+
+    // TriTreeNode pass
+    for (int frame = 0; frame < frames; frame++)
+    {
+        benchSetCamera((float) frame);
+
+        BenchClock::time_point t0 = BenchClock::now();
+        land->Reset();
+        land->Tessellate();
+        BenchClock::time_point t1 = BenchClock::now();
+        heightSums[frame] = 0;
+        leafCounts[frame] = benchCountLeaves(land, &heightSums[frame]);
+        BenchClock::time_point t2 = BenchClock::now();
+
+        tessMs[0] += benchMilliseconds(t0, t1);
+        walkMs[0] += benchMilliseconds(t1, t2);
+        numNodes[0] += land->GetTriPool().GetNumAllocated();
+    }
+
+    // CompactTriNode pass (Landscape::Reset() is still needed for the patch visibility)
+    for (int frame = 0; frame < frames; frame++)
+    {
+        benchSetCamera((float) frame);
+
+        BenchClock::time_point t0 = BenchClock::now();
+        land->Reset();
+        compact.Reset();
+        compact.Tessellate();
+        BenchClock::time_point t1 = BenchClock::now();
+        unsigned int heightSum = 0;
+        unsigned int leaves = compact.CountLeaves(&heightSum);
+        BenchClock::time_point t2 = BenchClock::now();
+
+        tessMs[1] += benchMilliseconds(t0, t1);
+        walkMs[1] += benchMilliseconds(t1, t2);
+        numNodes[1] += compact.GetNumNodes();
+
+        if (leaves != leafCounts[frame] || heightSum != heightSums[frame])
+            identical = false;
+    }
+
+    const char *names[2] = {"TriTreeNode", "CompactTriNode"};
+    const int nodeSizes[2] = {(int) sizeof(TriTreeNode), (int) sizeof(CompactTriNode)};
+
+    printf("Layout benchmark: %d frames, MAP_SIZE %d, frame variance %.2f\n", frames, MAP_SIZE, gFrameVariance);
+    printf("%-16s %6s %10s %10s %14s %12s\n", "layout", "bytes", "nodes", "pool KB", "tessellate ms", "walk ms");
+    for (int i = 0; i < 2; i++)
+    {
+        double nodes = numNodes[i] / frames;
+        printf("%-16s %6d %10.0f %10.1f %14.3f %12.3f\n", names[i], nodeSizes[i], nodes, nodes * nodeSizes[i] / 1024.0,
+               tessMs[i] / frames, walkMs[i] / frames);
+    }
+    printf("Meshes identical: %s\n", identical ? "yes" : "NO");
+
+    // Again with a node limit (--max-nodes, or half the nodes above): both layouts must stop at it, on the same split.
+    int savedMaxNodes = gMaxNodes;
+    gMaxNodes = (gMaxNodes > 0) ? gMaxNodes : (int) (numNodes[0] / frames / 2);
+    compact.SetMaxNodes((uint32_t) gMaxNodes);
+
+    int mostNodes[2] = {0, 0}, cracked = 0;
+    identical = true;
+
+    for (int frame = 0; frame < frames; frame++)
+    {
+        benchSetCamera((float) frame);
+
+        land->Reset();
+        land->Tessellate();
+        unsigned int heightSum = 0, compactHeightSum = 0;
+        unsigned int leaves = benchCountLeaves(land, &heightSum);
+
+        mostNodes[0] = std::max(mostNodes[0], land->GetTriPool().GetNumAllocated());
+        if (!land->IsConforming())
+            cracked++;
+
+        land->Reset();
+        compact.Reset();
+        compact.Tessellate();
+
+        mostNodes[1] = std::max(mostNodes[1], (int) compact.GetNumNodes());
+        if (compact.CountLeaves(&compactHeightSum) != leaves || compactHeightSum != heightSum)
+            identical = false;
+    }
+
+    printf("Node limit %d: most nodes in a frame %d / %d (%s), meshes identical: %s, frames with cracks: %d\n", gMaxNodes,
+           mostNodes[0], mostNodes[1], (std::max(mostNodes[0], mostNodes[1]) <= gMaxNodes) ? "kept" : "EXCEEDED",
+           identical ? "yes" : "NO", cracked);
+
+    gMaxNodes = savedMaxNodes;
+    compact.SetMaxNodes(0);
+}
+
+// Compare rebuilding the mesh every frame against refining it with the split/merge queues.
+// The split/merge cost should follow the camera speed, the rebuild cost should not.
+static void benchSplitMerge(int frames)
+{
+    Landscape *land = benchInitLandscape();
+    SplitMergeLandscape splitMerge(land);
+
+    benchSettleVariance(land);
+
+    const float speeds[6] = {0.0f, 0.1f, 0.25f, 0.5f, 1.0f, 2.0f};    // Degrees around the circle per frame
+
+    printf("Split/merge benchmark: %d frames, MAP_SIZE %d, %d desired nodes\n", frames, MAP_SIZE, gDesiredTris);
+    printf("%-12s %8s %10s %10s %10s %10s %10s\n", "engine", "deg/frm", "nodes", "ms/frame", "splits", "merges", "reprior.");
+
+    for (float speed : speeds)
+    {
+        double ms = 0, nodes = 0;
+
+        // Per-frame rebuild
+        for (int frame = 0; frame < frames; frame++)
+        {
+            benchSetCamera((float) frame * speed);
+
+            BenchClock::time_point t0 = BenchClock::now();
+            land->Reset();
+            land->Tessellate();
+            BenchClock::time_point t1 = BenchClock::now();
+
+            ms += benchMilliseconds(t0, t1);
+            nodes += land->GetTriPool().GetNumAllocated();
+        }
+
+        printf("%-12s %8.2f %10.0f %10.3f %10s %10s %10s\n", "rebuild", speed, nodes / frames, ms / frames, "-", "-", "-");
+
+        // Split/merge, starting from a mesh that already converged on the first camera position
+        benchSetCamera(0);
+        splitMerge.Init();
+        for (int frame = 0; frame < 10; frame++)
+            splitMerge.Update();
+
+        double splits = 0, merges = 0, recomputed = 0;
+        ms = nodes = 0;
+
+        for (int frame = 0; frame < frames; frame++)
+        {
+            benchSetCamera((float) frame * speed);
+
+            BenchClock::time_point t0 = BenchClock::now();
+            splitMerge.Update();
+            BenchClock::time_point t1 = BenchClock::now();
+
+            ms += benchMilliseconds(t0, t1);
+            nodes += splitMerge.GetNumNodes();
+            splits += splitMerge.GetNumSplits();
+            merges += splitMerge.GetNumMerges();
+            recomputed += splitMerge.GetNumRecomputed();
+        }
+
+        printf("%-12s %8.2f %10.0f %10.3f %10.0f %10.0f %10.0f\n", "split/merge", speed, nodes / frames, ms / frames,
+               splits / frames, merges / frames, recomputed / frames);
+        printf("Split/merge mesh conforming: %s\n", splitMerge.IsConforming() ? "yes" : "NO");
+    }
+}
+
+// Compare the serial tessellation against the parallel one for a few thread counts.
+// Uses a large node budget so there is enough work to spread, and checks every frame's mesh is identical.
+static void benchParallel(int frames)
+{
+    Landscape *land = benchInitLandscape();
+
+    gDesiredTris = 100000;
+    benchSettleVariance(land);
+
+    // Serial reference
+    std::vector<unsigned int> hashes(frames);
+    double serialMs = 0, nodes = 0;
+
+    gTessellateOrder = TESSELLATE_DEPTH_FIRST;
+    for (int frame = 0; frame < frames; frame++)
+    {
+        benchSetCamera((float) frame);
+
+        BenchClock::time_point t0 = BenchClock::now();
+        land->Reset();
+        land->Tessellate();
+        BenchClock::time_point t1 = BenchClock::now();
+
+        serialMs += benchMilliseconds(t0, t1);
+        nodes += land->GetNumNodes();
+        hashes[frame] = benchHashMesh(land);
+    }
+
+    printf("Parallel benchmark: %d frames, MAP_SIZE %d, frame variance %.2f, %.0f nodes\n", frames, MAP_SIZE,
+           gFrameVariance, nodes / frames);
+    printf("%-10s %8s %14s %10s %10s\n", "mode", "threads", "tessellate ms", "speedup", "identical");
+    printf("%-10s %8d %14.3f %10.2f %10s\n", "serial", 1, serialMs / frames, 1.0, "-");
+
+    std::vector<int> threadCounts = {1, 2, 4, 8};
+    if (gNumThreads > 0)
+        threadCounts = {gNumThreads};
+
+    gTessellateOrder = TESSELLATE_PARALLEL;
+    for (int threads : threadCounts)
+    {
+        gNumThreads = threads;
+
+        double ms = 0;
+        bool identical = true;
+
+        for (int frame = 0; frame < frames; frame++)
+        {
+            benchSetCamera((float) frame);
+
+            BenchClock::time_point t0 = BenchClock::now();
+            land->Reset();
+            land->Tessellate();
+            BenchClock::time_point t1 = BenchClock::now();
+
+            ms += benchMilliseconds(t0, t1);
+            if (benchHashMesh(land) != hashes[frame])
+                identical = false;
+        }
+
+        printf("%-10s %8d %14.3f %10.2f %10s\n", "parallel", threads, ms / frames, serialMs / ms, identical ? "yes" : "NO");
+    }
+
+    gTessellateOrder = TESSELLATE_DEPTH_FIRST;
+}
+
+// Compare drawing right after tessellating against the pipelined engine, which tessellates the next
+// frame while this one is drawn.  Walking the leaves stands in for the GL submission.
+static void benchPipeline(int frames)
+{
+    Landscape *land = benchInitLandscape();
+    gBenchLandBack.Init(gHeightMap);
+    PipelinedLandscape pipeline(land, &gBenchLandBack);
+
+    benchSettleVariance(land);
+
+    double serialMs = 0, pipelinedMs = 0, tessMs = 0;
+    unsigned int leaves = 0, heightSum = 0;
+
+    for (int frame = 0; frame < frames; frame++)
+    {
+        benchSetCamera((float) frame);
+
+        BenchClock::time_point t0 = BenchClock::now();
+        land->Update();
+        BenchClock::time_point t1 = BenchClock::now();
+        leaves += benchCountLeaves(land, &heightSum);
+        land->AdjustFrameVariance();
+        BenchClock::time_point t2 = BenchClock::now();
+
+        tessMs += benchMilliseconds(t0, t1);
+        serialMs += benchMilliseconds(t0, t2);
+    }
+
+    for (int frame = 0; frame < frames; frame++)
+    {
+        benchSetCamera((float) frame);
+
+        BenchClock::time_point t0 = BenchClock::now();
+        pipeline.BeginFrame();
+        leaves += benchCountLeaves(pipeline.GetFront(), &heightSum);
+        pipeline.EndFrame();
+        BenchClock::time_point t1 = BenchClock::now();
+
+        pipelinedMs += benchMilliseconds(t0, t1);
+    }
+
+    printf("Pipeline benchmark: %d frames, MAP_SIZE %d, %d desired nodes (%u leaves walked)\n", frames, MAP_SIZE,
+           gDesiredTris, leaves);
+    printf("%-10s %10s %14s\n", "engine", "frame ms", "tessellate ms");
+    printf("%-10s %10.3f %14.3f\n", "serial", serialMs / frames, tessMs / frames);
+    printf("%-10s %10.3f %14s\n", "pipelined", pipelinedMs / frames, "(hidden)");
+}
+
+// Gather every variance tree node of a base triangle, with the center of its hypotenuse.
+static void benchGatherNodes(const VarianceTree &variance, int leftX, int leftY, int rightX, int rightY, int apexX, int apexY,
+                             int node, std::vector<float> &samples)
+{
+    if (!variance.HasNode(node))
+        return;
+
+    int centerX = (leftX + rightX) >> 1;
+    int centerY = (leftY + rightY) >> 1;
+
+    samples.push_back(variance[node]);
+    samples.push_back(centerX);
+    samples.push_back(centerY);
+
+    benchGatherNodes(variance, apexX, apexY, leftX, leftY, centerX, centerY, node << 1, samples);
+    benchGatherNodes(variance, rightX, rightY, apexX, apexY, centerX, centerY, 1 + (node << 1), samples);
+}
+
+// Compare the original error metric (sqrt & division) against the squared distance one.
+// First on every variance tree node of the map, then inside a full tessellation.
+static void benchMetric(int frames)
+{
+    Landscape *land = benchInitLandscape();
+
+    // Use the frame variance the landscape settles on with the original metric.
+    gErrorMetric = METRIC_DISTANCE;
+    benchSettleVariance(land);
+
+    std::vector<float> samples;
+    for (int y = 0; y < NUM_PATCHES_PER_SIDE; y++)
+    {
+        for (int x = 0; x < NUM_PATCHES_PER_SIDE; x++)
+        {
+            Patch *patch = land->GetPatch(x, y);
+            int worldX = patch->GetWorldX();
+            int worldY = patch->GetWorldY();
+
+            benchGatherNodes(patch->GetVarianceLeft(), worldX, worldY + PATCH_SIZE, worldX + PATCH_SIZE, worldY,
+                             worldX, worldY, 1, samples);
+            benchGatherNodes(patch->GetVarianceRight(), worldX + PATCH_SIZE, worldY, worldX, worldY + PATCH_SIZE,
+                             worldX + PATCH_SIZE, worldY + PATCH_SIZE, 1, samples);
+        }
+    }
+
+    int numSamples = (int) samples.size() / 3;
+    std::vector<unsigned char> decisions[2];
+    double metricMs[2] = {0, 0};
+
+    for (int metric = METRIC_DISTANCE; metric <= METRIC_SQUARED_DISTANCE; metric++)
+    {
+        decisions[metric].resize(numSamples);
+
+        for (int frame = 0; frame < frames; frame++)
+        {
+            benchSetCamera((float) frame);
+
+            BenchClock::time_point t0 = BenchClock::now();
+            if (metric == METRIC_DISTANCE)
+            {
+                for (int i = 0; i < numSamples; i++)
+                    decisions[metric][i] = Patch::ComputeTriVariance(samples[i * 3], (int) samples[i * 3 + 1],
+                                                                     (int) samples[i * 3 + 2]) > gFrameVariance;
+            } else
+            {
+                float splitScale = Patch::GetSplitScale();
+                for (int i = 0; i < numSamples; i++)
+                    decisions[metric][i] = Patch::ExceedsFrameVariance(samples[i * 3], (int) samples[i * 3 + 1],
+                                                                       (int) samples[i * 3 + 2], splitScale);
+            }
+            BenchClock::time_point t1 = BenchClock::now();
+
+            metricMs[metric] += benchMilliseconds(t0, t1);
+        }
+    }
+
+    int mismatches = 0;
+    for (int i = 0; i < numSamples; i++)
+        if (decisions[0][i] != decisions[1][i])
+            mismatches++;
+
+    // Full tessellation with each metric
+    double tessMs[2] = {0, 0};
+    std::vector<unsigned int> hashes(frames);
+    int meshMismatches = 0;
+
+    for (int metric = METRIC_DISTANCE; metric <= METRIC_SQUARED_DISTANCE; metric++)
+    {
+        gErrorMetric = metric;
+
+        for (int frame = 0; frame < frames; frame++)
+        {
+            benchSetCamera((float) frame);
+
+            BenchClock::time_point t0 = BenchClock::now();
+            land->Reset();
+            land->Tessellate();
+            BenchClock::time_point t1 = BenchClock::now();
+
+            tessMs[metric] += benchMilliseconds(t0, t1);
+
+            unsigned int hash = benchHashMesh(land);
+            if (metric == METRIC_DISTANCE)
+                hashes[frame] = hash;
+            else if (hash != hashes[frame])
+                meshMismatches++;
+        }
+    }
+
+    const char *names[2] = {"distance", "squared"};
+
+    printf("Metric benchmark: %d frames, %d variance nodes, frame variance %.2f\n", frames, numSamples, gFrameVariance);
+    printf("%-10s %16s %14s\n", "metric", "Mnodes/second", "tessellate ms");
+    for (int metric = METRIC_DISTANCE; metric <= METRIC_SQUARED_DISTANCE; metric++)
+        printf("%-10s %16.1f %14.3f\n", names[metric], (double) numSamples * frames / (metricMs[metric] * 1000.0),
+               tessMs[metric] / frames);
+    printf("Different split decisions: %d of %d, different meshes: %d of %d frames\n", mismatches, numSamples,
+           meshMismatches, frames);
+
+    gErrorMetric = METRIC_SQUARED_DISTANCE;
+}
+
+// Hold gDesiredTris while the camera orbits the map and teleports every BENCH_TELEPORT_FRAMES frames.
+#define BENCH_TELEPORT_FRAMES 60
+
+static void benchController(int frames)
+{
+    Landscape *land = benchInitLandscape();
+    int savedMode = gController.GetMode();
+
+    printf("Controller benchmark: %d frames, MAP_SIZE %d, %d desired nodes, teleport every %d frames\n", frames,
+           MAP_SIZE, gDesiredTris, BENCH_TELEPORT_FRAMES);
+    printf("%-10s %10s %11s %10s %14s %11s %10s\n", "controller", "on target", "mean error", "max error",
+           "settle frames", "passes", "frame ms");
+
+    const char *names[] = {"nudge", "PID", "bisection"};
+    for (int mode = CONTROLLER_NUDGE; mode <= CONTROLLER_BISECTION; mode++)
+    {
+        gController.SetMode(mode);
+        gFrameVariance = 50;
+        benchSettleVariance(land);
+        gController.ResetStatistics();
+
+        double ms = 0;
+        float angle = 0;
+        for (int frame = 0; frame < frames; frame++)
+        {
+            // Orbit one degree a frame, with a jump to the other side of the map now and then.
+            angle += (frame % BENCH_TELEPORT_FRAMES == BENCH_TELEPORT_FRAMES - 1) ? 137.0f : 1.0f;
+            benchSetCamera(angle);
+
+            BenchClock::time_point t0 = BenchClock::now();
+            land->Update();
+            land->AdjustFrameVariance();
+            ms += benchMilliseconds(t0, BenchClock::now());
+        }
+
+        printf("%-10s %9.1f%% %10.2f%% %9.2f%% %6.1f (max %2d) %11.2f %10.3f\n", names[mode],
+               gController.GetOnTargetRatio() * 100.0f, gController.GetMeanError() * 100.0f,
+               gController.GetMaxError() * 100.0f, gController.GetMeanSettleFrames(), gController.GetMaxSettleFrames(),
+               gController.GetPassesPerFrame(), ms / frames);
+    }
+
+    gController.SetMode(savedMode);
+    gController.ResetStatistics();
+}
+
+// Tessellate under shrinking time budgets, checking that every cut off mesh is still conforming.
+static void benchBudget(int frames)
+{
+    Landscape *land = benchInitLandscape();
+    int savedBudget = gTimeBudget;
+
+    printf("Budget benchmark: %d frames, MAP_SIZE %d, %d desired nodes\n", frames, MAP_SIZE, gDesiredTris);
+    printf("%-10s %10s %10s %12s %10s %11s %12s\n", "budget us", "mean us", "max us", "utilisation", "nodes", "conforming",
+           "coarse/fine");
+
+    const int budgets[] = {0, 2000, 1000, 500, 250, 100, 50};
+    for (int budget : budgets)
+    {
+        gTimeBudget = 0;
+        gFrameVariance = 50;
+        benchSettleVariance(land);
+        gTimeBudget = budget;
+
+        double sumUs = 0, maxUs = 0, sumUsage = 0;
+        unsigned int nodes = 0;
+        int numPriority = 0;
+        bool conforming = true;
+
+        for (int frame = 0; frame < frames; frame++)
+        {
+            benchSetCamera((float) frame);
+
+            BenchClock::time_point t0 = BenchClock::now();
+            land->Update();
+            double us = benchMilliseconds(t0, BenchClock::now()) * 1000.0;
+            land->AdjustFrameVariance();
+
+            sumUs += us;
+            maxUs = std::max(maxUs, us);
+            sumUsage += gBudgetUsage;
+            nodes += land->GetNumNodes();
+            conforming = conforming && land->IsConforming();
+            numPriority += land->UsedPriority();
+        }
+
+        char name[16];
+        snprintf(name, sizeof(name), budget ? "%d" : "none", budget);
+
+        printf("%-10s %10.1f %10.1f %11.1f%% %10u %11s %11.1f%%\n", name, sumUs / frames, maxUs,
+               budget ? sumUsage / frames * 100.0 : 0.0, nodes / frames, conforming ? "yes" : "NO",
+               100.0 * numPriority / frames);
+    }
+
+    gTimeBudget = savedBudget;
+}
+
+// Append the nodes of a variance tree (node 0 is unused) to trees, byte by byte.
+static void benchAppendTree(const VarianceTree &tree, std::vector<unsigned char> &trees)
+{
+    size_t entrySize = VarianceTree::GetEntrySize(tree.Format);
+    const unsigned char *data = (const unsigned char *) tree.Data;
+
+    trees.insert(trees.end(), data + entrySize, data + ((size_t) 1 << tree.Depth) * entrySize);
+}
+
+// Rebuild every variance tree, as Landscape::Init() does at startup, on more and more threads.
+static void benchVariance(int frames)
+{
+    Landscape *land = benchInitLandscape();
+    int savedThreads = gNumThreads;
+
+    std::vector<int> threadCounts = {1, 2, 4, 8};
+    if (gNumThreads > 0)
+        threadCounts = {1, gNumThreads};
+
+    printf("Variance benchmark: %d rebuilds of %d patches, MAP_SIZE %d, %u cores\n", frames,
+           NUM_PATCHES_PER_SIDE * NUM_PATCHES_PER_SIDE, MAP_SIZE, std::thread::hardware_concurrency());
+
+    // Recursive against bottom up builder, on this thread.
+    std::vector<unsigned char> recursive, bottomUp;
+    double recursiveMs = 0, bottomUpMs = 0;
+    bool identical = true;
+
+    for (int frame = 0; frame < frames; frame++)
+    {
+        for (int y = 0; y < NUM_PATCHES_PER_SIDE; y++)
+        {
+            for (int x = 0; x < NUM_PATCHES_PER_SIDE; x++)
+            {
+                Patch *patch = land->GetPatch(x, y);
+
+                BenchClock::time_point t0 = BenchClock::now();
+                patch->ComputeVarianceRecursive();
+                BenchClock::time_point t1 = BenchClock::now();
+
+                recursive.clear();
+                benchAppendTree(patch->GetVarianceLeft(), recursive);
+                benchAppendTree(patch->GetVarianceRight(), recursive);
+
+                // Whole patch, not just the nodes under an edit.
+                patch->SetDirty();
+
+                BenchClock::time_point t2 = BenchClock::now();
+                patch->ComputeVariance();
+                BenchClock::time_point t3 = BenchClock::now();
+
+                recursiveMs += benchMilliseconds(t0, t1);
+                bottomUpMs += benchMilliseconds(t2, t3);
+
+                bottomUp.clear();
+                benchAppendTree(patch->GetVarianceLeft(), bottomUp);
+                benchAppendTree(patch->GetVarianceRight(), bottomUp);
+
+                identical = identical && bottomUp == recursive;
+            }
+        }
+    }
+
+    printf("%-10s %10s %10s\n", "builder", "build ms", "speedup");
+    printf("%-10s %10.3f %9.2fx\n", "recursive", recursiveMs / frames, 1.0);
+    printf("%-10s %10.3f %9.2fx\n", "bottom up", bottomUpMs / frames, recursiveMs / bottomUpMs);
+    printf("Bottom up trees identical to the recursive ones: %s\n\n", identical ? "yes" : "NO");
+
+    printf("%-10s %10s %10s\n", "threads", "build ms", "speedup");
+
+    double serialMs = 0;
+    for (int threads : threadCounts)
+    {
+        gNumThreads = threads;
+
+        double ms = 0;
+        for (int frame = 0; frame < frames; frame++)
+        {
+            for (int y = 0; y < NUM_PATCHES_PER_SIDE; y++)
+                for (int x = 0; x < NUM_PATCHES_PER_SIDE; x++)
+                    land->GetPatch(x, y)->SetDirty();
+
+            land->ComputeVariance();
+            ms += land->GetVarianceTime();
+        }
+
+        if (threads == 1)
+            serialMs = ms;
+
+        printf("%-10d %10.3f %9.2fx\n", threads, ms / frames, serialMs / ms);
+    }
+
+    gNumThreads = savedThreads;
+}
+
+// Craters blasted into the terrain every frame.
+#define BENCH_CRATERS_PER_FRAME 16
+
+// Deform the terrain every frame, then update the variance trees of just the nodes under the edits,
+// against recomputing the same patches from scratch.
+static void benchDeform(int frames)
+{
+    Landscape *land = benchInitLandscape();
+    std::vector<Patch *> dirty;
+    std::vector<unsigned char> localTrees, fullTrees;
+
+    double localMs = 0, fullMs = 0;
+    int numDirty = 0;
+    bool identical = true;
+
+    srand(1);
+    for (int frame = 0; frame < frames; frame++)
+    {
+        for (int crater = 0; crater < BENCH_CRATERS_PER_FRAME; crater++)
+            land->Crater(rand() % MAP_SIZE, rand() % MAP_SIZE, 2 + rand() % 6, 4 + rand() % 12);
+
+        dirty.clear();
+        for (int y = 0; y < NUM_PATCHES_PER_SIDE; y++)
+            for (int x = 0; x < NUM_PATCHES_PER_SIDE; x++)
+                if (land->GetPatch(x, y)->isDirty())
+                    dirty.push_back(land->GetPatch(x, y));
+
+        BenchClock::time_point t0 = BenchClock::now();
+        land->ComputeVariance();
+        BenchClock::time_point t1 = BenchClock::now();
+
+        localTrees.clear();
+        for (Patch *patch : dirty)
+        {
+            benchAppendTree(patch->GetVarianceLeft(), localTrees);
+            benchAppendTree(patch->GetVarianceRight(), localTrees);
+            patch->SetDirty();
+        }
+
+        BenchClock::time_point t2 = BenchClock::now();
+        land->ComputeVariance();
+        BenchClock::time_point t3 = BenchClock::now();
+
+        fullTrees.clear();
+        for (Patch *patch : dirty)
+        {
+            benchAppendTree(patch->GetVarianceLeft(), fullTrees);
+            benchAppendTree(patch->GetVarianceRight(), fullTrees);
+        }
+
+        identical = identical && fullTrees == localTrees;
+
+        localMs += benchMilliseconds(t0, t1);
+        fullMs += benchMilliseconds(t2, t3);
+        numDirty += (int) dirty.size();
+    }
+
+    printf("Deform benchmark: %d frames, MAP_SIZE %d, %d craters per frame, %.1f dirty patches per frame\n", frames,
+           MAP_SIZE, BENCH_CRATERS_PER_FRAME, (double) numDirty / frames);
+    printf("%-10s %10s %10s %10s\n", "update", "frame us", "crater us", "speedup");
+    printf("%-10s %10.1f %10.2f %9.2fx\n", "patches", fullMs * 1000.0 / frames,
+           fullMs * 1000.0 / frames / BENCH_CRATERS_PER_FRAME, 1.0);
+    printf("%-10s %10.1f %10.2f %9.2fx\n", "nodes", localMs * 1000.0 / frames,
+           localMs * 1000.0 / frames / BENCH_CRATERS_PER_FRAME, fullMs / localMs);
+    printf("Updated trees identical to recomputed ones: %s\n", identical ? "yes" : "NO");
+}
+
+// Frames between the whole map edits of the amortize benchmark.
+#define BENCH_EDIT_FRAMES 90
+
+// Dirty every patch now and then, and see how long the variance rebuild holds up a frame, and for how many
+// frames stale trees are drawn, with and without a per-frame budget.
+static void benchAmortize(int frames)
+{
+    Landscape *land = benchInitLandscape();
+    int savedBudget = gVarianceBudget;
+    std::vector<unsigned char> heights(gHeightMap, gHeightMap + MAP_SIZE * MAP_SIZE);
+
+    printf("Amortize benchmark: %d frames, MAP_SIZE %d, every patch dirtied every %d frames\n", frames, MAP_SIZE,
+           BENCH_EDIT_FRAMES);
+    printf("%-10s %12s %12s %14s %12s\n", "budget us", "max rebuild", "mean rebuild", "frames behind", "max frame");
+
+    const int budgets[] = {0, 1000, 500, 250, 100};
+    for (int budget : budgets)
+    {
+        gVarianceBudget = budget;
+        benchSettleVariance(land);
+
+        double maxMs = 0, sumMs = 0, maxFrameMs = 0;
+        int behind = 0, maxBehind = 0;
+
+        for (int frame = 0; frame < frames; frame++)
+        {
+            // Rewriting the map with its own heights leaves the trees as they are, but every patch has to be rebuilt.
+            if (frame % BENCH_EDIT_FRAMES == 0)
+                land->Deform(0, 0, MAP_SIZE, MAP_SIZE, heights.data());
+
+            benchSetCamera((float) frame);
+
+            BenchClock::time_point t0 = BenchClock::now();
+            land->Update();
+            maxFrameMs = std::max(maxFrameMs, benchMilliseconds(t0, BenchClock::now()));
+            land->AdjustFrameVariance();
+
+            maxMs = std::max(maxMs, land->GetVarianceTime());
+            sumMs += land->GetVarianceTime();
+
+            behind = land->GetVarianceQueueDepth() ? behind + 1 : 0;
+            maxBehind = std::max(maxBehind, behind);
+        }
+
+        char name[16];
+        snprintf(name, sizeof(name), budget ? "%d" : "none", budget);
+
+        printf("%-10s %9.3f ms %9.3f ms %14d %9.3f ms\n", name, maxMs, sumMs / frames, maxBehind, maxFrameMs);
+    }
+
+    gVarianceBudget = savedBudget;
+}
+
+// Add up the vertical error of a leaf triangle against the height map, in pixels, for every sample it covers that
+// no other leaf did, and count the samples more than a pixel off.  pixelsPerUnit is the screen space metric's projection.
+// Also keeps the largest error in worstError, if given.
+static void benchMeshError(TriTreeNode *tri, int leftX, int leftY, int rightX, int rightY, int apexX, int apexY,
+                           float pixelsPerUnit, std::vector<unsigned char> &covered, double *errorSum, int *numOverPixel,
+                           int *numSamples, float *worstError = nullptr)
+{
+    if (tri->LeftChild)
+    {
+        int centerX = (leftX + rightX) >> 1;
+        int centerY = (leftY + rightY) >> 1;
+
+        benchMeshError(tri->LeftChild, apexX, apexY, leftX, leftY, centerX, centerY, pixelsPerUnit, covered, errorSum,
+                       numOverPixel, numSamples, worstError);
+        benchMeshError(tri->RightChild, rightX, rightY, apexX, apexY, centerX, centerY, pixelsPerUnit, covered, errorSum,
+                       numOverPixel, numSamples, worstError);
+        return;
+    }
+
+    float leftZ = gHeightMap[(leftY * MAP_SIZE) + leftX];
+    float rightZ = gHeightMap[(rightY * MAP_SIZE) + rightX];
+    float apexZ = gHeightMap[(apexY * MAP_SIZE) + apexX];
+    float area = (float) ((rightX - leftX) * (apexY - leftY) - (rightY - leftY) * (apexX - leftX));
+
+    for (int y = std::min(std::min(leftY, rightY), apexY); y <= std::max(std::max(leftY, rightY), apexY); y++)
+    {
+        for (int x = std::min(std::min(leftX, rightX), apexX); x <= std::max(std::max(leftX, rightX), apexX); x++)
+        {
+            // Barycentric weights of the sample (all of them have the sign of the area inside the triangle)
+            float weightLeft = (float) ((apexX - rightX) * (y - rightY) - (apexY - rightY) * (x - rightX)) / area;
+            float weightRight = (float) ((leftX - apexX) * (y - apexY) - (leftY - apexY) * (x - apexX)) / area;
+            float weightApex = 1.0f - weightLeft - weightRight;
+
+            if (weightLeft < 0 || weightRight < 0 || weightApex < -1e-6f || covered[y * (MAP_SIZE + 1) + x])
+                continue;
+
+            covered[y * (MAP_SIZE + 1) + x] = 1;
+
+            float z = weightLeft * leftZ + weightRight * rightZ + weightApex * apexZ;
+            float error = fabsf(z - (float) gHeightMap[(y * MAP_SIZE) + x]);
+
+            float dx = (float) x - gViewPosition[0];
+            float dy = (float) y - gViewPosition[2];
+            float dz = z * MULT_SCALE - gViewPosition[1];
+            float pixels = error * MULT_SCALE * pixelsPerUnit / std::max(NEAR_CLIP, sqrtf(dx * dx + dy * dy + dz * dz));
+
+            *errorSum += pixels;
+            *numOverPixel += pixels > 1.0f;
+            (*numSamples)++;
+
+            if (worstError)
+                *worstError = std::max(*worstError, pixels);
+        }
+    }
+}
+
+// benchMeshError() over all the visible patches of this frame's mesh.
+static void benchLandscapeError(Landscape *land, float pixelsPerUnit, std::vector<unsigned char> &covered,
+                                double *errorSum, int *numOverPixel, int *numSamples, float *worstError = nullptr)
+{
+    std::fill(covered.begin(), covered.end(), 0);
+
+    for (int y = 0; y < NUM_PATCHES_PER_SIDE; y++)
+    {
+        for (int x = 0; x < NUM_PATCHES_PER_SIDE; x++)
+        {
+            Patch *patch = land->GetPatch(x, y);
+            if (!patch->isVisibile())
+                continue;
+
+            int worldX = patch->GetWorldX();
+            int worldY = patch->GetWorldY();
+
+            benchMeshError(patch->GetBaseLeft(), worldX, worldY + PATCH_SIZE, worldX + PATCH_SIZE, worldY,
+                           worldX, worldY, pixelsPerUnit, covered, errorSum, numOverPixel, numSamples, worstError);
+            benchMeshError(patch->GetBaseRight(), worldX + PATCH_SIZE, worldY, worldX, worldY + PATCH_SIZE,
+                           worldX + PATCH_SIZE, worldY + PATCH_SIZE, pixelsPerUnit, covered, errorSum,
+                           numOverPixel, numSamples, worstError);
+        }
+    }
+}
+
+// Memory and tessellation quality of the variance tree depths & formats.  Each one gets the same node budget
+// (the controller holds gDesiredTris), so the better the trees, the smaller the error left on screen.
+static void benchPrecision(int frames)
+{
+    Landscape *land = benchInitLandscape();
+    int savedDepth = gVarianceDepth, savedFormat = gVarianceFormat, savedCache = gUseVarianceCache;
+    std::vector<unsigned char> covered((MAP_SIZE + 1) * (MAP_SIZE + 1));
+    float pixelsPerUnit = ((float) gViewportWidth * 0.5f) / tanf(gFovX * 0.5f * (float) M_PI / 180.0f);
+
+    // Leave the cache file of the default configuration alone.
+    gUseVarianceCache = 0;
+
+    printf("Precision benchmark: %d frames, MAP_SIZE %d, PATCH_SIZE %d, %d desired nodes\n", frames, MAP_SIZE, PATCH_SIZE,
+           gDesiredTris);
+    printf("%-6s %-7s %10s %10s %10s %12s %12s\n", "depth", "format", "memory KB", "build ms", "nodes", "mean px err",
+           "over 1 px");
+
+    std::vector<int> depths;
+    for (int depth = VarianceBuilder::GetDefaultDepth() - 2; depth <= VarianceBuilder::GetMaxDepth(); depth++)
+        depths.push_back(depth);
+
+    for (int depth : depths)
+    {
+        for (int format = VARIANCE_8BIT; format <= VARIANCE_16BIT; format++)
+        {
+            gVarianceDepth = depth;
+            gVarianceFormat = format;
+            land->Init(gHeightMap);
+            double buildMs = land->GetVarianceTime();
+
+            benchSettleVariance(land);
+
+            double errorSum = 0;
+            int numOverPixel = 0, numSamples = 0, nodes = 0;
+
+            for (int frame = 0; frame < frames; frame++)
+            {
+                benchSetCamera((float) frame);
+                land->Update();
+                land->AdjustFrameVariance();
+                nodes += land->GetNumNodes();
+
+                benchLandscapeError(land, pixelsPerUnit, covered, &errorSum, &numOverPixel, &numSamples);
+            }
+
+            printf("%-6d %-7s %10.1f %10.3f %10d %12.4f %11.2f%%\n", depth, format == VARIANCE_16BIT ? "16 bit" : "8 bit",
+                   land->GetVarianceMemory() / 1024.0, buildMs, nodes / frames, errorSum / std::max(numSamples, 1),
+                   100.0 * numOverPixel / std::max(numSamples, 1));
+        }
+    }
+
+    gVarianceDepth = savedDepth;
+    gVarianceFormat = savedFormat;
+    gUseVarianceCache = savedCache;
+}
+
+// Compare the depth first and priority tessellation orders when the nodes run out.  The frame variance settles
+// for gDesiredTris, then both orders only get a quarter of that (or --max-nodes): depth first spends it on the
+// first patches in memory, priority on the worst error wherever it is, which shows in the worst error of each
+// frame.  The mean error is per height map sample, so it favours the far terrain.  Without a cap both orders
+// build the same mesh.
+static void benchOrder(int frames)
+{
+    Landscape *land = benchInitLandscape();
+    int savedOrder = gTessellateOrder, savedDesired = gDesiredTris, savedMaxNodes = gMaxNodes;
+    std::vector<unsigned char> covered((MAP_SIZE + 1) * (MAP_SIZE + 1));
+    float pixelsPerUnit = ((float) gViewportWidth * 0.5f) / tanf(gFovX * 0.5f * (float) M_PI / 180.0f);
+
+    gTessellateOrder = TESSELLATE_DEPTH_FIRST;
+    benchSettleVariance(land);
+
+    gMaxNodes = gDesiredTris = (savedMaxNodes > 0) ? savedMaxNodes : savedDesired / 4;
+
+    printf("Order benchmark: %d frames, MAP_SIZE %d, frame variance %.1f, node cap %d\n", frames, MAP_SIZE, gFrameVariance,
+           gMaxNodes);
+    printf("%-12s %10s %10s %12s %12s %12s %10s\n", "order", "ms/frame", "nodes", "mean px err", "worst px err",
+           "over 1 px", "cracks");
+
+    const int orders[2] = {TESSELLATE_DEPTH_FIRST, TESSELLATE_PRIORITY};
+    const char *names[2] = {"depth first", "priority"};
+
+    for (int order = 0; order < 2; order++)
+    {
+        gTessellateOrder = orders[order];
+
+        double ms = 0, errorSum = 0, worstSum = 0;
+        int numOverPixel = 0, numSamples = 0, nodes = 0, cracks = 0;
+
+        for (int frame = 0; frame < frames; frame++)
+        {
+            benchSetCamera((float) frame);
+
+            BenchClock::time_point t0 = BenchClock::now();
+            land->Reset();
+            land->Tessellate();
+            BenchClock::time_point t1 = BenchClock::now();
+
+            ms += benchMilliseconds(t0, t1);
+            nodes += land->GetNumNodes();
+            cracks += !land->IsConforming();
+
+            float worstError = 0;
+            benchLandscapeError(land, pixelsPerUnit, covered, &errorSum, &numOverPixel, &numSamples, &worstError);
+            worstSum += worstError;
+        }
+
+        printf("%-12s %10.3f %10d %12.4f %12.2f %11.2f%% %10d\n", names[order], ms / frames, nodes / frames,
+               errorSum / std::max(numSamples, 1), worstSum / frames, 100.0 * numOverPixel / std::max(numSamples, 1),
+               cracks);
+    }
+
+    // Without a cap, both orders stop at the frame variance.
+    gMaxNodes = 0;
+    gDesiredTris = INT_MAX;
+
+    int numDifferent = 0;
+    for (int frame = 0; frame < frames; frame++)
+    {
+        unsigned int hashes[2];
+        benchSetCamera((float) frame);
+
+        for (int order = 0; order < 2; order++)
+        {
+            gTessellateOrder = orders[order];
+            land->Reset();
+            land->Tessellate();
+            hashes[order] = benchHashMesh(land);
+        }
+
+        numDifferent += hashes[0] != hashes[1];
+    }
+
+    printf("Uncapped meshes identical: %s (%d of %d frames differ)\n", numDifferent ? "NO" : "yes", numDifferent, frames);
+
+    gTessellateOrder = savedOrder;
+    gDesiredTris = savedDesired;
+    gMaxNodes = savedMaxNodes;
+}
+
+// Entries of the simulated post-transform vertex cache (FIFO, like most hardware).
+#define BENCH_VERTEX_CACHE 32
+
+// Vertices an index stream makes the GPU transform, with a FIFO post-transform cache.
+static int benchCacheMisses(const GLushort *indices, int numIndices)
+{
+    int cache[BENCH_VERTEX_CACHE];
+    int next = 0, misses = 0;
+
+    std::fill(cache, cache + BENCH_VERTEX_CACHE, -1);
+
+    for (int i = 0; i < numIndices; i++)
+    {
+        if (indices[i] == STRIP_RESTART_INDEX ||
+            std::find(cache, cache + BENCH_VERTEX_CACHE, indices[i]) != cache + BENCH_VERTEX_CACHE)
+            continue;
+
+        cache[next] = indices[i];
+        next = (next + 1) % BENCH_VERTEX_CACHE;
+        misses++;
+    }
+
+    return misses;
+}
+
+// A triangle as its corner positions, turned to start at the smallest one so the winding is kept.
+typedef std::vector<float> BenchTriangle;
+
+static void benchAddTriangle(const StreamVertex &a, const StreamVertex &b, const StreamVertex &c,
+                             std::vector<BenchTriangle> &triangles)
+{
+    const StreamVertex *corners[3] = {&a, &b, &c};
+    BenchTriangle best;
+
+    for (int rotation = 0; rotation < 3; rotation++)
+    {
+        BenchTriangle tri;
+        for (int i = 0; i < 3; i++)
+        {
+            const StreamVertex *corner = corners[(rotation + i) % 3];
+            tri.insert(tri.end(), {corner->X, corner->Y, corner->Z});
+        }
+
+        if (best.empty() || tri < best)
+            best = tri;
+    }
+
+    triangles.push_back(best);
+}
+
+// The triangles of a strip, without the degenerate ones, with the winding each one is drawn with.
+static void benchStripTriangles(const StreamVertex *vertices, const GLushort *indices, int count,
+                                std::vector<BenchTriangle> &triangles)
+{
+    for (int i = 0; i + 2 < count; i++)
+    {
+        int a = indices[i], b = indices[i + 1], c = indices[i + 2];
+        if (a == b || b == c || a == c)
+            continue;
+
+        if (i & 1)
+            std::swap(a, b);
+
+        benchAddTriangle(vertices[a], vertices[b], vertices[c], triangles);
+    }
+}
+
+// What the vertex buffer render paths send to the GPU, extracted to plain memory (no GL needed).
+static void benchRender(int frames)
+{
+    Landscape *land = benchInitLandscape();
+    int savedDrawMode = gDrawMode;
+
+    benchSettleVariance(land);
+
+    std::vector<StreamVertex> vertices(POOL_SIZE * 3), flat(POOL_SIZE * 3);
+    std::vector<GridVertex> grid(POOL_SIZE * 3);
+    std::vector<unsigned char> packed(POOL_SIZE * 3 * IndexedMesh::GetVertexSize(VERTEX_PACKED_LIT));
+    std::vector<GLushort> indices(POOL_SIZE * 6);
+    std::vector<BenchTriangle> reference, triangles;
+    IndexedMesh mesh;
+
+    printf("Render benchmark: %d frames, MAP_SIZE %d, PATCH_SIZE %d, %d byte vertices (%d displaced, %d packed, %d lit), "
+           "%d entry vertex cache\n", frames, MAP_SIZE, PATCH_SIZE, (int) sizeof(StreamVertex), (int) sizeof(GridVertex),
+           (int) IndexedMesh::GetVertexSize(VERTEX_PACKED), (int) IndexedMesh::GetVertexSize(VERTEX_PACKED_LIT),
+           BENCH_VERTEX_CACHE);
+    printf("%-10s %-10s %10s %10s %10s %12s %16s %10s %12s\n", "mode", "path", "triangles", "vertices", "indices",
+           "KB / frame", "transformed/tri", "tris/strip", "extract ms");
+
+    bool identical = true;
+    const int modes[2] = {DRAW_USE_FILL_ONLY, DRAW_USE_LIGHTING};
+    const char *modeNames[2] = {"fill", "lighting"};
+    const char *pathNames[5] = {"triangles", "indexed", "strips", "displaced", "packed"};
+
+    for (int m = 0; m < 2; m++)
+    {
+        gDrawMode = modes[m];
+
+        double extractMs[5] = {0, 0, 0, 0, 0}, numVertices[5] = {0, 0, 0, 0, 0}, numIndices[5] = {0, 0, 0, 0, 0};
+        double misses[5] = {0, 0, 0, 0, 0};
+        int packedFormat = (gDrawMode == DRAW_USE_LIGHTING) ? VERTEX_PACKED_LIT : VERTEX_PACKED;
+        int formats[5] = {VERTEX_FULL, VERTEX_FULL, VERTEX_FULL, VERTEX_GRID, packedFormat};
+        double numTris = 0, numStrips = 0;
+
+        for (int frame = 0; frame < frames; frame++)
+        {
+            benchSetCamera((float) frame);
+            land->Reset();
+            land->Tessellate();
+
+            for (int y = 0; y < NUM_PATCHES_PER_SIDE; y++)
+            {
+                for (int x = 0; x < NUM_PATCHES_PER_SIDE; x++)
+                {
+                    Patch *patch = land->GetPatch(x, y);
+                    if (!patch->isVisibile())
+                        continue;
+
+                    BenchClock::time_point t0 = BenchClock::now();
+                    int count = patch->Extract(patch->GetBaseLeft(), patch->GetBaseRight(), flat.data(), (int) flat.size());
+                    extractMs[0] += benchMilliseconds(t0, BenchClock::now());
+
+                    numVertices[0] += count;
+                    numIndices[0] += count;
+                    misses[0] += count;
+                    numTris += count / 3;
+
+                    reference.clear();
+                    for (int i = 0; i < count; i += 3)
+                        benchAddTriangle(flat[i], flat[i + 1], flat[i + 2], reference);
+                    std::sort(reference.begin(), reference.end());
+
+                    // The indexed paths must draw the same triangles, wound the same way.
+                    for (int path = 1; path < 5; path++)
+                    {
+                        mesh.Strips = (path >= 2);
+                        mesh.Format = formats[path];
+
+                        void *out = (void *) vertices.data();
+                        if (path == 3)
+                            out = grid.data();
+                        else if (path == 4)
+                            out = packed.data();
+
+                        t0 = BenchClock::now();
+                        mesh.Begin(out, (int) vertices.size(), indices.data(), (int) indices.size());
+                        patch->ExtractIndexed(patch->GetBaseLeft(), patch->GetBaseRight(), mesh);
+                        extractMs[path] += benchMilliseconds(t0, BenchClock::now());
+
+                        // Displace the grid points as the shader does, to compare them.
+                        if (path == 3)
+                        {
+                            for (int i = 0; i < mesh.NumVertices; i++)
+                            {
+                                vertices[i].X = grid[i].X;
+                                vertices[i].Y = patch->GetHeight(patch->GetWorldX() + grid[i].X, patch->GetWorldY() + grid[i].Y);
+                                vertices[i].Z = grid[i].Y;
+                            }
+                        }
+
+                        // And the packed bytes.
+                        if (path == 4)
+                        {
+                            for (int i = 0; i < mesh.NumVertices; i++)
+                            {
+                                const PackedVertex &vertex =
+                                    *(const PackedVertex *) &packed[i * IndexedMesh::GetVertexSize(packedFormat)];
+                                vertices[i].X = vertex.X;
+                                vertices[i].Y = vertex.Height;
+                                vertices[i].Z = vertex.Y;
+                            }
+                        }
+
+                        numVertices[path] += mesh.NumVertices;
+                        numIndices[path] += mesh.NumIndices;
+                        misses[path] += benchCacheMisses(indices.data(), mesh.NumIndices);
+
+                        triangles.clear();
+                        if (mesh.Strips)
+                        {
+                            if (path == 2)
+                                numStrips += mesh.StripRanges.size() / 2;
+
+                            for (size_t strip = 0; strip < mesh.StripRanges.size(); strip += 2)
+                                benchStripTriangles(vertices.data(), &indices[mesh.StripRanges[strip]],
+                                                    mesh.StripRanges[strip + 1], triangles);
+                        }
+                        else
+                        {
+                            for (int i = 0; i < mesh.NumIndices; i += 3)
+                                benchAddTriangle(vertices[indices[i]], vertices[indices[i + 1]], vertices[indices[i + 2]],
+                                                 triangles);
+                        }
+
+                        std::sort(triangles.begin(), triangles.end());
+                        if (triangles != reference)
+                            identical = false;
+                    }
+                }
+            }
+        }
+
+        for (int path = 0; path < 5; path++)
+        {
+            double kb = numVertices[path] * IndexedMesh::GetVertexSize(formats[path]) / 1024.0;
+            if (path > 0)
+                kb += numIndices[path] * sizeof(GLushort) / 1024.0;
+
+            char stripLength[16] = "-";
+            if (path >= 2)
+                snprintf(stripLength, sizeof(stripLength), "%.1f", numTris / std::max(numStrips, 1.0));
+
+            printf("%-10s %-10s %10.0f %10.0f %10.0f %12.1f %16.2f %10s %12.3f\n", modeNames[m], pathNames[path],
+                   numTris / frames, numVertices[path] / frames, numIndices[path] / frames, kb / frames,
+                   misses[path] / std::max(numTris, 1.0), stripLength, extractMs[path] / frames);
+        }
+    }
+
+    printf("Meshes identical: %s\n", identical ? "yes" : "NO");
+
+    gDrawMode = savedDrawMode;
+}
+
+// The normals lighting needed for a mesh: one face normal per leaf (how it used to be done), or a normal map
+// lookup per corner.  Returns the leaves, sums the normals so the work can't be skipped.
+static int benchLightLeaves(Patch *patch, const NormalMap *normals, TriTreeNode *tri, int leftX, int leftY, int rightX,
+                            int rightY, int apexX, int apexY, float *sum)
+{
+    if (tri->LeftChild)
+    {
+        int centerX = (leftX + rightX) >> 1;
+        int centerY = (leftY + rightY) >> 1;
+
+        return benchLightLeaves(patch, normals, tri->LeftChild, apexX, apexY, leftX, leftY, centerX, centerY, sum) +
+               benchLightLeaves(patch, normals, tri->RightChild, rightX, rightY, apexX, apexY, centerX, centerY, sum);
+    }
+
+    float normal[3];
+
+    if (normals)
+    {
+        normals->Get(leftX, leftY, normal);
+        *sum += normal[1];
+        normals->Get(rightX, rightY, normal);
+        *sum += normal[1];
+        normals->Get(apexX, apexY, normal);
+        *sum += normal[1];
+    }
+    else
+    {
+        float v[3][3] = {{(float) leftX, (float) gHeightMap[leftY * MAP_SIZE + leftX], (float) leftY},
+                         {(float) rightX, (float) gHeightMap[rightY * MAP_SIZE + rightX], (float) rightY},
+                         {(float) apexX, (float) gHeightMap[apexY * MAP_SIZE + apexX], (float) apexY}};
+
+        Utility::CalcNormal(v, normal);
+        *sum += normal[1];
+    }
+
+    return 1;
+}
+
+// Building the normal map, how close its packed normals are, and what lighting costs per frame with it.
+static void benchNormals(int frames)
+{
+    Landscape *land = benchInitLandscape();
+
+    std::vector<int> threadCounts = {1, 2, 4, 8};
+    if (gNumThreads > 0)
+        threadCounts = {1, gNumThreads};
+
+    printf("Normals benchmark: %d builds & frames, MAP_SIZE %d, %u cores\n", frames, MAP_SIZE,
+           std::thread::hardware_concurrency());
+
+    NormalMap scalar, simd;
+    double scalarMs = 0, simdMs = 0;
+
+    for (int i = 0; i < frames; i++)
+    {
+        BenchClock::time_point t0 = BenchClock::now();
+        scalar.Build(gHeightMap, nullptr, false);
+        BenchClock::time_point t1 = BenchClock::now();
+        simd.Build(gHeightMap, nullptr, true);
+        BenchClock::time_point t2 = BenchClock::now();
+
+        scalarMs += benchMilliseconds(t0, t1);
+        simdMs += benchMilliseconds(t1, t2);
+    }
+
+    bool identical = !memcmp(scalar.GetData(), simd.GetData(), scalar.GetMemory());
+
+    printf("%-10s %10s %10s %12s\n", "builder", "build ms", "speedup", "memory KB");
+    printf("%-10s %10.3f %9.2fx %12.1f\n", "scalar", scalarMs / frames, 1.0, scalar.GetMemory() / 1024.0);
+    printf("%-10s %10.3f %9.2fx %12.1f\n", "SIMD", simdMs / frames, scalarMs / simdMs, simd.GetMemory() / 1024.0);
+
+    printf("\n%-10s %10s %10s\n", "threads", "build ms", "speedup");
+
+    double serialMs = 0;
+    for (int threads : threadCounts)
+    {
+        ThreadPool workers(threads);
+        NormalMap normals;
+
+        BenchClock::time_point t0 = BenchClock::now();
+        for (int i = 0; i < frames; i++)
+            normals.Build(gHeightMap, &workers);
+        double ms = benchMilliseconds(t0, BenchClock::now());
+
+        identical = identical && !memcmp(scalar.GetData(), normals.GetData(), scalar.GetMemory());
+
+        if (threads == 1)
+            serialMs = ms;
+
+        printf("%-10d %10.3f %9.2fx\n", threads, ms / frames, serialMs / ms);
+    }
+
+    printf("SIMD & threaded maps identical to the scalar one: %s\n", identical ? "yes" : "NO");
+
+    // Angle between the packed normals and the exact ones (same differences, in floats), and how far from unit length.
+    double errorSum = 0, errorMax = 0, lengthMax = 0;
+    for (int y = 0; y < MAP_SIZE; y++)
+    {
+        for (int x = 0; x < MAP_SIZE; x++)
+        {
+            int left = std::max(x - 1, 0), right = std::min(x + 1, MAP_SIZE - 1);
+            int up = std::max(y - 1, 0), down = std::min(y + 1, MAP_SIZE - 1);
+
+            float exact[3] = {(float) (gHeightMap[y * MAP_SIZE + left] - gHeightMap[y * MAP_SIZE + right]) / (right - left), 1.0f,
+                              (float) (gHeightMap[up * MAP_SIZE + x] - gHeightMap[down * MAP_SIZE + x]) / (down - up)};
+            Utility::ReduceToUnit(exact);
+
+            float packed[3];
+            simd.Get(x, y, packed);
+
+            double length = sqrt((double) packed[0] * packed[0] + (double) packed[1] * packed[1] + (double) packed[2] * packed[2]);
+            double dot = ((double) exact[0] * packed[0] + (double) exact[1] * packed[1] + (double) exact[2] * packed[2]) / length;
+            double angle = acos(std::min(1.0, dot)) * 180.0 / M_PI;
+
+            lengthMax = std::max(lengthMax, fabs(length - 1.0));
+
+            errorSum += angle;
+            errorMax = std::max(errorMax, angle);
+        }
+    }
+
+    printf("Packed normal error: mean %.3f, max %.3f degrees, length off by %.2f%% at most\n\n",
+           errorSum / ((double) MAP_SIZE * MAP_SIZE), errorMax, lengthMax * 100.0);
+
+    // Per frame: a face normal for every leaf against three lookups.
+    benchSettleVariance(land);
+
+    double ms[2] = {0, 0};
+    int leaves = 0;
+    float sum = 0;
+
+    for (int frame = 0; frame < frames; frame++)
+    {
+        benchSetCamera((float) frame);
+        land->Reset();
+        land->Tessellate();
+
+        for (int lookup = 0; lookup < 2; lookup++)
+        {
+            const NormalMap *normals = lookup ? &land->GetNormalMap() : nullptr;
+
+            BenchClock::time_point t0 = BenchClock::now();
+            for (int y = 0; y < NUM_PATCHES_PER_SIDE; y++)
+            {
+                for (int x = 0; x < NUM_PATCHES_PER_SIDE; x++)
+                {
+                    Patch *patch = land->GetPatch(x, y);
+                    if (!patch->isVisibile())
+                        continue;
+
+                    int worldX = patch->GetWorldX(), worldY = patch->GetWorldY();
+                    int count = benchLightLeaves(patch, normals, patch->GetBaseLeft(), worldX, worldY + PATCH_SIZE,
+                                                 worldX + PATCH_SIZE, worldY, worldX, worldY, &sum);
+                    count += benchLightLeaves(patch, normals, patch->GetBaseRight(), worldX + PATCH_SIZE, worldY, worldX,
+                                              worldY + PATCH_SIZE, worldX + PATCH_SIZE, worldY + PATCH_SIZE, &sum);
+
+                    if (lookup)
+                        leaves += count;
+                }
+            }
+            ms[lookup] += benchMilliseconds(t0, BenchClock::now());
+        }
+    }
+
+    printf("%-20s %10s %12s\n", "lighting normals", "leaves", "ms / frame");
+    printf("%-20s %10d %12.3f\n", "face (CalcNormal)", leaves / frames, ms[0] / frames);
+    printf("%-20s %10d %12.3f\n", "normal map lookup", leaves / frames, ms[1] / frames);
+    printf("(checksum %.1f)\n", sum);
+}
+
+// How often a patch is tessellated the same way as the frame before, and what the geometry cache saves on those:
+// a fingerprint of its trees instead of writing out its strips.  No GL, so the uploads saved are not in here.
+static void benchCache(int frames)
+{
+    Landscape *land = benchInitLandscape();
+    SplitMergeLandscape splitMerge(land);
+
+    benchSettleVariance(land);
+
+    const float speeds[3] = {0.0f, 0.1f, 2.0f};    // Degrees around the circle per frame
+    const char *engineNames[2] = {"rebuild", "split/merge"};
+
+    std::vector<StreamVertex> vertices(POOL_SIZE * 3);
+    std::vector<GLushort> indices(POOL_SIZE * 6);
+    std::unordered_map<const TriTreeNode *, std::vector<unsigned int>> shapes;
+    std::vector<unsigned int> shape;
+    IndexedMesh mesh;
+    mesh.Strips = true;
+
+    printf("Geometry cache benchmark: %d frames, MAP_SIZE %d, PATCH_SIZE %d, strips\n", frames, MAP_SIZE, PATCH_SIZE);
+    printf("%-12s %8s %10s %8s %16s %12s %12s\n", "engine", "deg/frm", "patches", "hits", "fingerprint ms", "extract ms",
+           "uncached ms");
+
+    for (int engine = 0; engine < 2; engine++)
+    {
+        for (float speed : speeds)
+        {
+            shapes.clear();
+
+            // Split/merge starts from a mesh that already converged on the first camera position.
+            if (engine == 1)
+            {
+                benchSetCamera(0);
+                splitMerge.Init();
+                for (int frame = 0; frame < 10; frame++)
+                    splitMerge.Update();
+            }
+
+            double patches = 0, hits = 0, fingerprintMs = 0, missMs = 0, hitMs = 0;
+
+            for (int frame = 0; frame < frames; frame++)
+            {
+                benchSetCamera((float) frame * speed);
+
+                // As roamDrawFrame() does.
+                if (engine == 0)
+                {
+                    land->Update();
+                    land->AdjustFrameVariance();
+                }
+                else
+                    splitMerge.Update();
+
+                for (int y = 0; y < NUM_PATCHES_PER_SIDE; y++)
+                {
+                    for (int x = 0; x < NUM_PATCHES_PER_SIDE; x++)
+                    {
+                        Patch *patch = land->GetPatch(x, y);
+                        if (engine == 0 ? !patch->isVisibile() : !splitMerge.IsPatchVisible(x, y))
+                            continue;
+
+                        TriTreeNode *baseLeft = (engine == 0) ? patch->GetBaseLeft() : splitMerge.GetBaseLeft(x, y);
+                        TriTreeNode *baseRight = (engine == 0) ? patch->GetBaseRight() : splitMerge.GetBaseRight(x, y);
+
+                        BenchClock::time_point t0 = BenchClock::now();
+                        patch->Fingerprint(baseLeft, baseRight, shape);
+                        BenchClock::time_point t1 = BenchClock::now();
+
+                        std::vector<unsigned int> &cached = shapes[baseLeft];
+                        bool hit = (cached == shape);
+
+                        // Written either way, to time what a hit saves.
+                        mesh.Begin(vertices.data(), (int) vertices.size(), indices.data(), (int) indices.size());
+                        patch->ExtractIndexed(baseLeft, baseRight, mesh);
+                        BenchClock::time_point t2 = BenchClock::now();
+
+                        fingerprintMs += benchMilliseconds(t0, t1);
+                        (hit ? hitMs : missMs) += benchMilliseconds(t1, t2);
+
+                        if (!hit)
+                            cached.swap(shape);
+
+                        patches++;
+                        hits += hit;
+                    }
+                }
+            }
+
+            printf("%-12s %8.1f %10.1f %7.1f%% %16.3f %12.3f %12.3f\n", engineNames[engine], speed, patches / frames,
+                   100.0 * hits / std::max(patches, 1.0), fingerprintMs / frames, missMs / frames, (missMs + hitMs) / frames);
+        }
+    }
+}
+
+// A checksum of what an extractor wrote, to check every thread count writes the same.
+static unsigned int benchHashMeshes(MeshExtractor &extractor, bool indexed)
+{
+    unsigned int hash = 2166136261u;
+
+    for (int i = 0; i < extractor.GetNumMeshes(); i++)
+    {
+        const PatchMesh &mesh = extractor.GetMesh(i);
+        const unsigned char *bytes = mesh.Vertices.data();
+
+        for (size_t b = 0; b < (size_t) mesh.Count * extractor.GetVertexSize(); b++)
+            hash = (hash ^ bytes[b]) * 16777619u;
+
+        for (int index = 0; indexed && index < mesh.NumIndices; index++)
+            hash = (hash ^ mesh.Indices[index]) * 16777619u;
+    }
+
+    return hash;
+}
+
+// Mesh extraction of the whole frame on the worker threads, as MeshRenderer does before drawing, against one thread.
+static void benchExtract(int frames)
+{
+    Landscape *land = benchInitLandscape();
+    int savedThreads = gNumThreads;
+    int savedDrawMode = gDrawMode;
+
+    gDesiredTris = 100000;
+    gDrawMode = DRAW_USE_LIGHTING;
+    benchSettleVariance(land);
+
+    std::vector<int> threadCounts = {1, 2, 4, 8};
+    if (gNumThreads > 0)
+        threadCounts = {1, gNumThreads};
+
+    const char *pathNames[2] = {"stream", "strips"};
+    std::vector<double> ms(threadCounts.size());
+    MeshExtractor extractor;
+
+    printf("Extract benchmark: %d frames, MAP_SIZE %d, lighting on, %d nodes wanted\n", frames, MAP_SIZE, gDesiredTris);
+    printf("%-8s %8s %12s %10s %10s\n", "path", "threads", "extract ms", "speedup", "identical");
+
+    for (int path = 0; path < 2; path++)
+    {
+        std::fill(ms.begin(), ms.end(), 0.0);
+        bool identical = true;
+
+        for (int frame = 0; frame < frames; frame++)
+        {
+            benchSetCamera((float) frame);
+            land->Reset();
+            land->Tessellate();
+
+            unsigned int reference = 0;
+
+            for (size_t t = 0; t < threadCounts.size(); t++)
+            {
+                gNumThreads = threadCounts[t];
+
+                extractor.Begin(VERTEX_FULL, path == 1, path == 1, false);
+                for (int y = 0; y < NUM_PATCHES_PER_SIDE; y++)
+                {
+                    for (int x = 0; x < NUM_PATCHES_PER_SIDE; x++)
+                    {
+                        Patch *patch = land->GetPatch(x, y);
+                        if (patch->isVisibile())
+                            extractor.Add(patch, patch->GetBaseLeft(), patch->GetBaseRight());
+                    }
+                }
+
+                // The first frame of a thread count sets up its pool & buffers: leave it out.
+                BenchClock::time_point t0 = BenchClock::now();
+                extractor.Extract();
+                if (frame > 0)
+                    ms[t] += benchMilliseconds(t0, BenchClock::now());
+
+                unsigned int hash = benchHashMeshes(extractor, path == 1);
+                if (t == 0)
+                    reference = hash;
+                else if (hash != reference)
+                    identical = false;
+            }
+        }
+
+        for (size_t t = 0; t < threadCounts.size(); t++)
+            printf("%-8s %8d %12.3f %10.2f %10s\n", pathNames[path], threadCounts[t], ms[t] / std::max(frames - 1, 1),
+                   ms[0] / std::max(ms[t], 1e-9), (t == 0) ? "-" : (identical ? "yes" : "NO"));
+    }
+
+    gNumThreads = savedThreads;
+    gDrawMode = savedDrawMode;
+}
+
+bool runBenchmark(const char *name, int frames)
+{
+    if (frames <= 0)
+        frames = 360;
+
+    if (!strcmp(name, "layout"))
+        benchLayout(frames);
+    else if (!strcmp(name, "splitmerge"))
+        benchSplitMerge(frames);
+    else if (!strcmp(name, "parallel"))
+        benchParallel(frames);
+    else if (!strcmp(name, "pipeline"))
+        benchPipeline(frames);
+    else if (!strcmp(name, "metric"))
+        benchMetric(frames);
+    else if (!strcmp(name, "controller"))
+        benchController(frames);
+    else if (!strcmp(name, "budget"))
+        benchBudget(frames);
+    else if (!strcmp(name, "variance"))
+        benchVariance(frames);
+    else if (!strcmp(name, "deform"))
+        benchDeform(frames);
+    else if (!strcmp(name, "amortize"))
+        benchAmortize(frames);
+    else if (!strcmp(name, "precision"))
+        benchPrecision(frames);
+    else if (!strcmp(name, "order"))
+        benchOrder(frames);
+    else if (!strcmp(name, "render"))
+        benchRender(frames);
+    else if (!strcmp(name, "normals"))
+        benchNormals(frames);
+    else if (!strcmp(name, "cache"))
+        benchCache(frames);
+    else if (!strcmp(name, "extract"))
+        benchExtract(frames);
+    else
+    {
+        std::cout << "Unknown benchmark: " << name << std::endl;
+        return false;
+    }
+
+    freeTerrain();
+    return true;
+}
+
+// Mean & worst time of a stage over the frames.
+struct HeadlessStage
+{
+    const char *Name;
+    double Total, Worst;
+};
+
+static void headlessAdd(HeadlessStage &stage, double ms)
+{
+    stage.Total += ms;
+    stage.Worst = std::max(stage.Worst, ms);
+}
+
+bool runHeadless(int frames)
+{
+    if (frames <= 0)
+        frames = 360;
+
+    BenchClock::time_point t0 = BenchClock::now();
+    Landscape *land = benchInitLandscape();
+    double loadMs = benchMilliseconds(t0, BenchClock::now());
+
+    // Meshes as the buffer render path would write them.  Immediate mode writes none.
+    bool extract = gRenderPath != RENDER_IMMEDIATE;
+    int format = VERTEX_FULL;
+    if (gRenderPath == RENDER_DISPLACED)
+        format = VERTEX_GRID;
+    else if (gRenderPath == RENDER_PACKED)
+        format = (gDrawMode == DRAW_USE_LIGHTING) ? VERTEX_PACKED_LIT : VERTEX_PACKED;
+
+    bool indexed = gRenderPath >= RENDER_INDEXED, strips = gRenderPath >= RENDER_STRIPS;
+
+    MeshExtractor extractor;
+    HeadlessStage stages[4] = {{"reset", 0, 0}, {"tessellate", 0, 0}, {"extract", 0, 0}, {"frame", 0, 0}};
+    double nodes = 0, passes = 0, triangles = 0, vertices = 0, bytes = 0;
+
+    for (int frame = 0; frame < frames; frame++)
+    {
+        // Around the map, like the animated follow mode.
+        benchSetCamera((float) frame);
+
+        // The same frame as roamDrawFrame(): as many passes as the budget controller asks for.
+        BenchClock::time_point start = BenchClock::now();
+        land->Update();
+        BenchClock::time_point update = BenchClock::now();
+
+        extractor.Begin(format, indexed, strips, false);
+        for (int y = 0; extract && y < NUM_PATCHES_PER_SIDE; y++)
+        {
+            for (int x = 0; x < NUM_PATCHES_PER_SIDE; x++)
+            {
+                Patch *patch = land->GetPatch(x, y);
+                if (patch->isVisibile())
+                    extractor.Add(patch, patch->GetBaseLeft(), patch->GetBaseRight());
+            }
+        }
+
+        extractor.Extract();
+        BenchClock::time_point end = BenchClock::now();
+
+        headlessAdd(stages[0], land->GetResetTime());
+        headlessAdd(stages[1], land->GetTessellateTime());
+        headlessAdd(stages[2], benchMilliseconds(update, end));
+        headlessAdd(stages[3], benchMilliseconds(start, end));
+
+        nodes += land->GetNumNodes();
+        passes += land->GetNumPasses();
+        for (int i = 0; i < extractor.GetNumMeshes(); i++)
+        {
+            const PatchMesh &mesh = extractor.GetMesh(i);
+
+            triangles += mesh.NumTriangles;
+            vertices += mesh.Count;
+            bytes += (double) mesh.Count * extractor.GetVertexSize() + (indexed ? mesh.NumIndices * sizeof(GLushort) : 0);
+        }
+
+        land->AdjustFrameVariance();
+    }
+
+    printf("Headless: %d frames, MAP_SIZE %d, PATCH_SIZE %d, extraction on %d thread(s), load %.1f ms\n", frames, MAP_SIZE,
+           PATCH_SIZE, gNumThreads > 0 ? gNumThreads : (int) std::max(1u, std::thread::hardware_concurrency()), loadMs);
+    printf("%.0f nodes in %.2f passes, %.0f triangles, %.0f vertices, %.1f KB of mesh per frame\n", nodes / frames,
+           passes / frames, triangles / frames, vertices / frames, bytes / 1024.0 / frames);
+    printf("%-12s %10s %10s\n", "stage", "mean ms", "worst ms");
+
+    for (const HeadlessStage &stage : stages)
+        printf("%-12s %10.3f %10.3f\n", stage.Name, stage.Total / frames, stage.Worst);
+
+    freeTerrain();
+    return true;
+}
@@ -0,0 +1,26 @@
+//  Benchmark.h
+//  Bryan Turner (original version), Rodrigo Verdiani (SDL version)
+//
+//  Parts of the code in this file were borrowed from numerous public sources &
+//  literature.  I reserve NO rights to this code and give a hearty thank-you to all the
+//  excellent sources used in this project.  These include, but are not limited to:
+//
+//  Longbow Digital Arts Programming Forum (www.LongbowDigitalArts.com)
+//  Gamasutra Features (www.Gamasutra.com)
+//  GameDev References (www.GameDev.net)
+//  C. Cookson's ROAM implementation (C.J.Cookson@dcs.warwick.ac.uk OR cjcookson@hotmail.com)
+//  OpenGL Super Bible (Waite Group Press)
+//  And many more...
+
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+// Run one of the command line benchmarks ("roamsdl --bench-<name> [frames]").
+// These never touch SDL or OpenGL.  Returns false if the benchmark name is unknown.
+extern bool runBenchmark(const char *name, int frames);
+
+// Drive the camera around the map for a number of frames ("roamsdl --headless [frames]"), resetting, tessellating and
+// extracting the meshes to memory, then print how long each stage took.  No SDL or OpenGL either.
+extern bool runHeadless(int frames);
+
+#endif
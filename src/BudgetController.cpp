@@ -0,0 +1,167 @@
+//  BudgetController.cpp
+//  Bryan Turner (original version), Rodrigo Verdiani (SDL version)
+//
+//  Parts of the code in this file were borrowed from numerous public sources &
+//  literature.  I reserve NO rights to this code and give a hearty thank-you to all the
+//  excellent sources used in this project.  These include, but are not limited to:
+//
+//  Longbow Digital Arts Programming Forum (www.LongbowDigitalArts.com)
+//  Gamasutra Features (www.Gamasutra.com)
+//  GameDev References (www.GameDev.net)
+//  C. Cookson's ROAM implementation (C.J.Cookson@dcs.warwick.ac.uk OR cjcookson@hotmail.com)
+//  OpenGL Super Bible (Waite Group Press)
+//  And many more...
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+#include "BudgetController.h"
+#include "Landscape.h"
+
+BudgetController::BudgetController()
+{
+    m_Mode = CONTROLLER_BISECTION;
+    SetGains(CONTROLLER_KP, CONTROLLER_KI, CONTROLLER_KD);
+    BeginFrame();
+    ResetStatistics();
+}
+
+void BudgetController::SetMode(int mode)
+{
+    m_Mode = mode;
+    m_Integral = m_LastError = 0;
+}
+
+void BudgetController::SetGains(float kp, float ki, float kd)
+{
+    m_Kp = kp;
+    m_Ki = ki;
+    m_Kd = kd;
+    m_Integral = m_LastError = 0;
+}
+
+void BudgetController::BeginFrame()
+{
+    m_Pass = 0;
+    m_LowVariance = m_HighVariance = 0;
+    m_LowNodes = m_HighNodes = 0;
+}
+
+// Bisection over the frame variance.  More variance means fewer nodes, so the bracket is
+// [variance with too many nodes, variance with too few].  Until both ends are known, jump by the
+// node count ratio; once they are, interpolate in log space (the count is close to a power of the variance).
+bool BudgetController::Retry(int numNodes)
+{
+    m_Pass++;
+    m_NumPasses++;
+
+    if (m_Mode != CONTROLLER_BISECTION || gErrorMetric == METRIC_SCREEN_SPACE)
+        return false;
+
+    float error = ((float) numNodes - (float) gDesiredTris) / (float) gDesiredTris;
+    if (fabsf(error) <= CONTROLLER_TOLERANCE || m_Pass >= CONTROLLER_MAX_PASSES)
+        return false;
+
+    float variance = std::max(gFrameVariance, CONTROLLER_MIN_VARIANCE);
+
+    if (numNodes > gDesiredTris)
+    {
+        m_LowVariance = variance;
+        m_LowNodes = numNodes;
+    } else
+    {
+        // Even the finest mesh is too small: nothing left to gain.
+        if (variance <= CONTROLLER_MIN_VARIANCE)
+            return false;
+
+        m_HighVariance = variance;
+        m_HighNodes = numNodes;
+    }
+
+    float next;
+    if (m_LowNodes && m_HighNodes)
+    {
+        // Where log(nodes) crosses log(target) on the line through both ends of the bracket.
+        float t = logf((float) m_LowNodes / (float) gDesiredTris) / logf((float) m_LowNodes / (float) std::max(1, m_HighNodes));
+        t = std::min(0.9f, std::max(0.1f, t));
+        next = expf(logf(m_LowVariance) + t * (logf(m_HighVariance) - logf(m_LowVariance)));
+    } else
+        next = variance * ((float) std::max(1, numNodes) / (float) gDesiredTris);
+
+    gFrameVariance = std::max(next, CONTROLLER_MIN_VARIANCE);
+    return true;
+}
+
+void BudgetController::EndFrame(int numNodes)
+{
+    float error = ((float) numNodes - (float) gDesiredTris) / (float) gDesiredTris;
+
+    switch (m_Mode)
+    {
+        case CONTROLLER_NUDGE:
+            // Check to see if we got close to the desired number of triangles.
+            // Adjust the frame variance to a better value.
+            if (numNodes != gDesiredTris)
+                gFrameVariance += error;
+
+            // Bounds checking.
+            if (gFrameVariance < 0)
+                gFrameVariance = 0;
+            break;
+
+        case CONTROLLER_PID:
+        {
+            float logError = logf((float) std::max(1, numNodes) / (float) gDesiredTris);
+
+            m_Integral = std::min(5.0f, std::max(-5.0f, m_Integral + logError));
+            float output = m_Kp * logError + m_Ki * m_Integral + m_Kd * (logError - m_LastError);
+            m_LastError = logError;
+
+            gFrameVariance = std::max(CONTROLLER_MIN_VARIANCE, std::max(gFrameVariance, CONTROLLER_MIN_VARIANCE) * expf(output));
+            break;
+        }
+
+        default:
+            // Bisection already put the frame variance where it needs to be.
+            break;
+    }
+
+    // Statistics
+    m_NumFrames++;
+    m_SumError += fabsf(error);
+    m_MaxError = std::max(m_MaxError, fabsf(error));
+
+    if (fabsf(error) <= CONTROLLER_TOLERANCE)
+    {
+        m_NumOnTarget++;
+
+        if (m_OffTarget)
+        {
+            m_NumSettles++;
+            m_SumSettleFrames += m_OffTarget;
+            m_MaxSettleFrames = std::max(m_MaxSettleFrames, m_OffTarget);
+            m_OffTarget = 0;
+        }
+    } else
+        m_OffTarget++;
+}
+
+void BudgetController::ResetStatistics()
+{
+    m_NumFrames = m_NumOnTarget = m_NumPasses = 0;
+    m_SumError = 0;
+    m_MaxError = 0;
+    m_OffTarget = m_NumSettles = m_SumSettleFrames = m_MaxSettleFrames = 0;
+}
+
+void BudgetController::PrintStatistics() const
+{
+    const char *names[] = {"nudge", "PID", "bisection"};
+
+    std::cout << "Budget controller (" << names[m_Mode] << "): " << m_NumFrames << " frames, "
+              << GetOnTargetRatio() * 100.0f << "% within " << CONTROLLER_TOLERANCE * 100.0f << "% of the target, "
+              << "mean error " << GetMeanError() * 100.0f << "%, max error " << GetMaxError() * 100.0f << "%, "
+              << "settles in " << GetMeanSettleFrames() << " frames (max " << GetMaxSettleFrames() << "), "
+              << GetPassesPerFrame() << " passes per frame" << std::endl;
+}
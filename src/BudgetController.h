@@ -0,0 +1,125 @@
+//  BudgetController.h
+//  Bryan Turner (original version), Rodrigo Verdiani (SDL version)
+//
+//  Parts of the code in this file were borrowed from numerous public sources &
+//  literature.  I reserve NO rights to this code and give a hearty thank-you to all the
+//  excellent sources used in this project.  These include, but are not limited to:
+//
+//  Longbow Digital Arts Programming Forum (www.LongbowDigitalArts.com)
+//  Gamasutra Features (www.Gamasutra.com)
+//  GameDev References (www.GameDev.net)
+//  C. Cookson's ROAM implementation (C.J.Cookson@dcs.warwick.ac.uk OR cjcookson@hotmail.com)
+//  OpenGL Super Bible (Waite Group Press)
+//  And many more...
+
+#ifndef BUDGETCONTROLLER_H
+#define BUDGETCONTROLLER_H
+
+// Node count within this fraction of gDesiredTris counts as on target.
+#define CONTROLLER_TOLERANCE 0.03f
+
+// Most tessellation passes per frame in CONTROLLER_BISECTION mode.
+#define CONTROLLER_MAX_PASSES 6
+
+// Default PID gains.  The error is log(nodes / gDesiredTris) and the output scales the frame variance
+// by exp(output), since the node count follows a power of the frame variance.
+#define CONTROLLER_KP 0.5f
+#define CONTROLLER_KI 0.15f
+#define CONTROLLER_KD 0.0f
+
+// Lowest frame variance the PID & bisection modes go down to.
+#define CONTROLLER_MIN_VARIANCE 0.01f
+
+// Controller Modes
+enum CONTROLLER_MODES
+{
+    CONTROLLER_NUDGE = 0,        // Original: gFrameVariance += (nodes - gDesiredTris) / gDesiredTris every frame
+    CONTROLLER_PID,                // PID on the log of the node count, one correction per frame
+    CONTROLLER_BISECTION        // Re-tessellate within the frame, bisecting the frame variance until on target
+};
+
+// BudgetController Class
+// Steers gFrameVariance so the tessellation uses gDesiredTris nodes, and keeps statistics on how well it does.
+class BudgetController
+{
+protected:
+    int m_Mode;
+    float m_Kp, m_Ki, m_Kd;
+    float m_Integral;                                            // PID state
+    float m_LastError;
+
+    // Bracket of the bisection for the current frame (frame variance & node count at each end, 0 == none)
+    int m_Pass;
+    float m_LowVariance, m_HighVariance;
+    int m_LowNodes, m_HighNodes;
+
+    // Statistics
+    int m_NumFrames;                                            // Frames measured
+    int m_NumOnTarget;                                            // Frames within CONTROLLER_TOLERANCE
+    int m_NumPasses;                                            // Tessellation passes over all frames
+    double m_SumError;                                            // Sum of |nodes - target| / target
+    float m_MaxError;
+    int m_OffTarget;                                            // Consecutive frames off target right now
+    int m_NumSettles;                                            // Times the count went off target and came back
+    int m_SumSettleFrames;                                        // Frames it took to come back, in total
+    int m_MaxSettleFrames;
+
+public:
+    BudgetController();
+
+    void SetMode(int mode);
+
+    int GetMode() const
+    {
+        return m_Mode;
+    }
+
+    void SetGains(float kp, float ki, float kd);
+
+    // Call before the first tessellation pass of a frame.
+    void BeginFrame();
+
+    // Call after each tessellation pass.  Returns true if the frame should be tessellated again
+    // with the new gFrameVariance (CONTROLLER_BISECTION only).
+    bool Retry(int numNodes);
+
+    // Call once per frame with the node count of the final mesh.  Updates gFrameVariance for the next frame.
+    void EndFrame(int numNodes);
+
+    void ResetStatistics();
+    void PrintStatistics() const;
+
+    float GetMeanError() const
+    {
+        return m_NumFrames ? (float) (m_SumError / m_NumFrames) : 0.0f;
+    }
+
+    float GetMaxError() const
+    {
+        return m_MaxError;
+    }
+
+    float GetOnTargetRatio() const
+    {
+        return m_NumFrames ? (float) m_NumOnTarget / (float) m_NumFrames : 0.0f;
+    }
+
+    float GetPassesPerFrame() const
+    {
+        return m_NumFrames ? (float) m_NumPasses / (float) m_NumFrames : 0.0f;
+    }
+
+    float GetMeanSettleFrames() const
+    {
+        return m_NumSettles ? (float) m_SumSettleFrames / (float) m_NumSettles : 0.0f;
+    }
+
+    int GetMaxSettleFrames() const
+    {
+        return m_MaxSettleFrames;
+    }
+};
+
+extern BudgetController gController;
+
+#endif
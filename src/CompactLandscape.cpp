@@ -0,0 +1,277 @@
+//  CompactLandscape.cpp
+//  Bryan Turner (original version), Rodrigo Verdiani (SDL version)
+//
+//  Parts of the code in this file were borrowed from numerous public sources &
+//  literature.  I reserve NO rights to this code and give a hearty thank-you to all the
+//  excellent sources used in this project.  These include, but are not limited to:
+//
+//  Longbow Digital Arts Programming Forum (www.LongbowDigitalArts.com)
+//  Gamasutra Features (www.Gamasutra.com)
+//  GameDev References (www.GameDev.net)
+//  C. Cookson's ROAM implementation (C.J.Cookson@dcs.warwick.ac.uk OR cjcookson@hotmail.com)
+//  OpenGL Super Bible (Waite Group Press)
+//  And many more...
+
+#include <cmath>
+#include <cstdlib>
+
+#include "CompactLandscape.h"
+
+CompactLandscape::CompactLandscape(Landscape *land)
+{
+    m_Land = land;
+    m_Nodes.resize(GetBaseLeft(0, NUM_PATCHES_PER_SIDE) + POOL_SIZE);
+    m_NumNodes = GetBaseLeft(0, NUM_PATCHES_PER_SIDE);
+    m_MaxNodes = 0;
+    m_CurrentVariance = nullptr;
+}
+
+// Allocate two adjacent nodes.  Returns the index of the first one, or 0 if the node limit was reached.
+// NOTE: May grow the pool, so references into m_Nodes must be fetched again afterwards.
+uint32_t CompactLandscape::AllocatePair()
+{
+    if (!HasRoom(2))
+        return 0;
+
+    if (m_NumNodes + 2 > m_Nodes.size())
+        m_Nodes.resize(m_Nodes.size() * 2);
+
+    uint32_t pair = m_NumNodes;
+    m_NumNodes += 2;
+
+    m_Nodes[pair].Children = m_Nodes[pair + 1].Children = 0;
+
+    return pair;
+}
+
+// Reset the base triangles of every patch and link the visible ones together.
+void CompactLandscape::Reset()
+{
+    m_NumNodes = GetBaseLeft(0, NUM_PATCHES_PER_SIDE);
+
+    for (int y = 0; y < NUM_PATCHES_PER_SIDE; y++)
+    {
+        for (int x = 0; x < NUM_PATCHES_PER_SIDE; x++)
+        {
+            CompactTriNode &baseLeft = m_Nodes[GetBaseLeft(x, y)];
+            CompactTriNode &baseRight = m_Nodes[GetBaseRight(x, y)];
+
+            // Attach the two base triangles together, clear the other relationships
+            baseLeft = {0, GetBaseRight(x, y), 0, 0};
+            baseRight = {0, GetBaseLeft(x, y), 0, 0};
+
+            if (!m_Land->GetPatch(x, y)->isVisibile())
+                continue;
+
+            // Link all the patches together, exactly like Landscape::Reset()
+            if (x > 0 && m_Land->GetPatch(x - 1, y)->isVisibile())
+                baseLeft.LeftNeighbor = GetBaseRight(x - 1, y);
+
+            if (x < (NUM_PATCHES_PER_SIDE - 1) && m_Land->GetPatch(x + 1, y)->isVisibile())
+                baseRight.LeftNeighbor = GetBaseLeft(x + 1, y);
+
+            if (y > 0 && m_Land->GetPatch(x, y - 1)->isVisibile())
+                baseLeft.RightNeighbor = GetBaseRight(x, y - 1);
+
+            if (y < (NUM_PATCHES_PER_SIDE - 1) && m_Land->GetPatch(x, y + 1)->isVisibile())
+                baseRight.RightNeighbor = GetBaseLeft(x, y + 1);
+        }
+    }
+}
+
+// Will correctly force-split diamonds.  Same algorithm as Patch::Split().
+void CompactLandscape::Split(uint32_t tri)
+{
+    // We are already split, no need to do it again.
+    if (m_Nodes[tri].Children)
+        return;
+
+    // If this triangle is not in a proper diamond, force split our base neighbor
+    uint32_t baseNeighbor = m_Nodes[tri].BaseNeighbor;
+    if (baseNeighbor && (m_Nodes[baseNeighbor].BaseNeighbor != tri))
+    {
+        Split(baseNeighbor);
+
+        // Out of nodes.  Splitting only us would leave a crack along the base.
+        baseNeighbor = m_Nodes[tri].BaseNeighbor;
+        if (m_Nodes[baseNeighbor].BaseNeighbor != tri)
+            return;
+    }
+
+    // Room for both halves of the diamond, or none.  Same test as Patch::Split().
+    if (!HasRoom((baseNeighbor && !m_Nodes[baseNeighbor].Children) ? 4 : 2))
+        return;
+
+    // Create children and link into mesh.
+    uint32_t leftChild = AllocatePair();
+    if (!leftChild)
+        return;
+
+    uint32_t rightChild = leftChild + 1;
+
+    // The pool does not grow again until the final Split() below, so these references stay valid.
+    CompactTriNode *nodes = m_Nodes.data();
+    CompactTriNode &t = nodes[tri];
+    CompactTriNode &left = nodes[leftChild];
+    CompactTriNode &right = nodes[rightChild];
+
+    t.Children = leftChild;
+
+    // Fill in the information we can get from the parent (neighbor indices)
+    left.BaseNeighbor = t.LeftNeighbor;
+    left.LeftNeighbor = rightChild;
+
+    right.BaseNeighbor = t.RightNeighbor;
+    right.RightNeighbor = leftChild;
+
+    // Link our Left Neighbor to the new children
+    if (t.LeftNeighbor)
+    {
+        CompactTriNode &n = nodes[t.LeftNeighbor];
+        if (n.BaseNeighbor == tri)
+            n.BaseNeighbor = leftChild;
+        else if (n.LeftNeighbor == tri)
+            n.LeftNeighbor = leftChild;
+        else if (n.RightNeighbor == tri)
+            n.RightNeighbor = leftChild;
+    }
+
+    // Link our Right Neighbor to the new children
+    if (t.RightNeighbor)
+    {
+        CompactTriNode &n = nodes[t.RightNeighbor];
+        if (n.BaseNeighbor == tri)
+            n.BaseNeighbor = rightChild;
+        else if (n.RightNeighbor == tri)
+            n.RightNeighbor = rightChild;
+        else if (n.LeftNeighbor == tri)
+            n.LeftNeighbor = rightChild;
+    }
+
+    // Link our Base Neighbor to the new children
+    if (t.BaseNeighbor)
+    {
+        uint32_t baseChildren = nodes[t.BaseNeighbor].Children;
+        if (baseChildren)
+        {
+            nodes[baseChildren].RightNeighbor = rightChild;
+            nodes[baseChildren + 1].LeftNeighbor = leftChild;
+            left.RightNeighbor = baseChildren + 1;
+            right.LeftNeighbor = baseChildren;
+        } else
+            Split(t.BaseNeighbor); // Base Neighbor (in a diamond with us) was not split yet, so do that now.
+    } else
+    {
+        // An edge triangle, trivial case.
+        left.RightNeighbor = 0;
+        right.LeftNeighbor = 0;
+    }
+}
+
+// Tessellate a Patch.  Same metric as Patch::RecursTessellate().
+void CompactLandscape::RecursTessellate(uint32_t tri, int leftX, int leftY, int rightX, int rightY, int apexX, int apexY, int node)
+{
+    bool split = true;
+
+    // Compute X and Y coordinates of center of Hypotenuse
+    int centerX = (leftX + rightX) >> 1;
+    int centerY = (leftY + rightY) >> 1;
+
+    if (m_CurrentVariance->HasNode(node))
+    {
+        float variance = (*m_CurrentVariance)[node];
+
+        if (gErrorMetric == METRIC_SCREEN_SPACE)
+            split = Patch::ExceedsPixelTolerance(variance, centerX, centerY,
+                                                 m_Land->GetHeightMap()[centerY * MAP_SIZE + centerX], m_SplitScale);
+        else if (gErrorMetric == METRIC_SQUARED_DISTANCE)
+            split = Patch::ExceedsFrameVariance(variance, centerX, centerY, m_SplitScale);
+        else
+            split = Patch::ComputeTriVariance(variance, centerX, centerY) > gFrameVariance;
+    }
+
+    if (split)
+    {
+        // Split this triangle.
+        Split(tri);
+
+        // If this triangle was split, try to split its children as well.
+        uint32_t children = m_Nodes[tri].Children;
+        if (children && ((abs(leftX - rightX) >= 3) || (abs(leftY - rightY) >= 3)))
+        {
+            RecursTessellate(children, apexX, apexY, leftX, leftY, centerX, centerY, node << 1);
+            RecursTessellate(children + 1, rightX, rightY, apexX, apexY, centerX, centerY, 1 + (node << 1));
+        }
+    }
+}
+
+// Create an approximate mesh of the visible patches.
+void CompactLandscape::Tessellate()
+{
+    m_SplitScale = Patch::GetSplitScale();
+
+    for (int y = 0; y < NUM_PATCHES_PER_SIDE; y++)
+    {
+        for (int x = 0; x < NUM_PATCHES_PER_SIDE; x++)
+        {
+            Patch *patch = m_Land->GetPatch(x, y);
+            if (!patch->isVisibile())
+                continue;
+
+            int worldX = patch->GetWorldX();
+            int worldY = patch->GetWorldY();
+
+            m_CurrentVariance = &patch->GetVarianceLeft();
+            RecursTessellate(GetBaseLeft(x, y), worldX, worldY + PATCH_SIZE, worldX + PATCH_SIZE, worldY, worldX, worldY, 1);
+
+            m_CurrentVariance = &patch->GetVarianceRight();
+            RecursTessellate(GetBaseRight(x, y), worldX + PATCH_SIZE, worldY, worldX, worldY + PATCH_SIZE,
+                             worldX + PATCH_SIZE, worldY + PATCH_SIZE, 1);
+        }
+    }
+}
+
+// Walk the tree down to the leaves, summing the heights of the triangle corners.
+unsigned int CompactLandscape::RecursCountLeaves(uint32_t tri, int leftX, int leftY, int rightX, int rightY, int apexX, int apexY,
+                                                 unsigned int *heightSum) const
+{
+    uint32_t children = m_Nodes[tri].Children;
+    if (children)
+    {
+        int centerX = (leftX + rightX) >> 1;
+        int centerY = (leftY + rightY) >> 1;
+
+        return RecursCountLeaves(children, apexX, apexY, leftX, leftY, centerX, centerY, heightSum) +
+               RecursCountLeaves(children + 1, rightX, rightY, apexX, apexY, centerX, centerY, heightSum);
+    }
+
+    const unsigned char *hMap = m_Land->GetHeightMap();
+    *heightSum += hMap[(leftY * MAP_SIZE) + leftX] + hMap[(rightY * MAP_SIZE) + rightX] + hMap[(apexY * MAP_SIZE) + apexX];
+
+    return 1;
+}
+
+unsigned int CompactLandscape::CountLeaves(unsigned int *heightSum) const
+{
+    unsigned int leaves = 0;
+
+    for (int y = 0; y < NUM_PATCHES_PER_SIDE; y++)
+    {
+        for (int x = 0; x < NUM_PATCHES_PER_SIDE; x++)
+        {
+            Patch *patch = m_Land->GetPatch(x, y);
+            if (!patch->isVisibile())
+                continue;
+
+            int worldX = patch->GetWorldX();
+            int worldY = patch->GetWorldY();
+
+            leaves += RecursCountLeaves(GetBaseLeft(x, y), worldX, worldY + PATCH_SIZE, worldX + PATCH_SIZE, worldY,
+                                        worldX, worldY, heightSum);
+            leaves += RecursCountLeaves(GetBaseRight(x, y), worldX + PATCH_SIZE, worldY, worldX, worldY + PATCH_SIZE,
+                                        worldX + PATCH_SIZE, worldY + PATCH_SIZE, heightSum);
+        }
+    }
+
+    return leaves;
+}
@@ -0,0 +1,94 @@
+//  CompactLandscape.h
+//  Bryan Turner (original version), Rodrigo Verdiani (SDL version)
+//
+//  Parts of the code in this file were borrowed from numerous public sources &
+//  literature.  I reserve NO rights to this code and give a hearty thank-you to all the
+//  excellent sources used in this project.  These include, but are not limited to:
+//
+//  Longbow Digital Arts Programming Forum (www.LongbowDigitalArts.com)
+//  Gamasutra Features (www.Gamasutra.com)
+//  GameDev References (www.GameDev.net)
+//  C. Cookson's ROAM implementation (C.J.Cookson@dcs.warwick.ac.uk OR cjcookson@hotmail.com)
+//  OpenGL Super Bible (Waite Group Press)
+//  And many more...
+
+#ifndef COMPACTLANDSCAPE_H
+#define COMPACTLANDSCAPE_H
+
+#include <cstdint>
+#include <vector>
+
+#include "Landscape.h"
+
+// CompactTriNode Struct
+// Same tree as TriTreeNode, but links are 32-bit indices into the node pool (0 == none).
+// Children are always allocated as an adjacent pair, so one index finds both of them.
+// 16 bytes per node instead of 40 on 64-bit platforms.
+struct CompactTriNode
+{
+    uint32_t Children;                                            // Left child (the right child is Children + 1)
+    uint32_t BaseNeighbor;
+    uint32_t LeftNeighbor;
+    uint32_t RightNeighbor;
+};
+
+// CompactLandscape Class
+// Tessellates the patches of a Landscape into CompactTriNodes.
+// Uses the Landscape's variance trees and visibility, so call Landscape::Reset() before Reset().
+class CompactLandscape
+{
+protected:
+    Landscape *m_Land;                                            // Landscape providing heights, variance & visibility
+    std::vector<CompactTriNode> m_Nodes;                        // Node pool.  Node 0 is the "none" sentinel
+    uint32_t m_NumNodes;                                        // Nodes in use this frame (including the sentinel)
+    uint32_t m_MaxNodes;                                        // Hard limit on nodes per frame (0 == grow without limit)
+
+    const VarianceTree *m_CurrentVariance;                        // Variance tree used by the current RecursTessellate pass
+    float m_SplitScale;                                            // Patch::GetSplitScale() of the current Tessellate pass
+
+    // Index of the base triangles of the patch at (x, y).  Both bases are allocated as a pair as well.
+    static uint32_t GetBaseLeft(int x, int y)
+    {
+        return 1 + 2 * (y * NUM_PATCHES_PER_SIDE + x);
+    }
+
+    static uint32_t GetBaseRight(int x, int y)
+    {
+        return GetBaseLeft(x, y) + 1;
+    }
+
+    bool HasRoom(uint32_t count) const
+    {
+        return !m_MaxNodes || GetNumNodes() + count <= m_MaxNodes;
+    }
+
+    uint32_t AllocatePair();
+
+    void Split(uint32_t tri);
+    void RecursTessellate(uint32_t tri, int leftX, int leftY, int rightX, int rightY, int apexX, int apexY, int node);
+    unsigned int RecursCountLeaves(uint32_t tri, int leftX, int leftY, int rightX, int rightY, int apexX, int apexY,
+                                   unsigned int *heightSum) const;
+
+public:
+    explicit CompactLandscape(Landscape *land);
+
+    void Reset();
+    void Tessellate();
+
+    // Walk all leaves of the visible patches, the way Patch::RecursRender does, without any GL calls.
+    // Returns the number of leaf triangles and adds their corner heights to heightSum.
+    unsigned int CountLeaves(unsigned int *heightSum) const;
+
+    void SetMaxNodes(uint32_t maxNodes)
+    {
+        m_MaxNodes = maxNodes;
+    }
+
+    // Nodes created by splits this frame (comparable to TriPool::GetNumAllocated()).
+    uint32_t GetNumNodes() const
+    {
+        return m_NumNodes - GetBaseLeft(0, NUM_PATCHES_PER_SIDE);
+    }
+};
+
+#endif
@@ -0,0 +1,95 @@
+//  GLExtensions.cpp
+//  Bryan Turner (original version), Rodrigo Verdiani (SDL version)
+//
+//  Parts of the code in this file were borrowed from numerous public sources &
+//  literature.  I reserve NO rights to this code and give a hearty thank-you to all the
+//  excellent sources used in this project.  These include, but are not limited to:
+//
+//  Longbow Digital Arts Programming Forum (www.LongbowDigitalArts.com)
+//  Gamasutra Features (www.Gamasutra.com)
+//  GameDev References (www.GameDev.net)
+//  C. Cookson's ROAM implementation (C.J.Cookson@dcs.warwick.ac.uk OR cjcookson@hotmail.com)
+//  OpenGL Super Bible (Waite Group Press)
+//  And many more...
+
+
+#include <SDL.h>
+#include <cstdio>
+
+#include "GLExtensions.h"
+
+GLExtensions::GLExtensions()
+{
+    GenBuffers = nullptr;
+    DeleteBuffers = nullptr;
+    BindBuffer = nullptr;
+    BufferData = nullptr;
+    MapBuffer = nullptr;
+    UnmapBuffer = nullptr;
+    MultiDrawElements = nullptr;
+    PrimitiveRestartIndex = nullptr;
+    ActiveTexture = nullptr;
+    CreateShader = nullptr;
+    DeleteShader = nullptr;
+    ShaderSource = nullptr;
+    CompileShader = nullptr;
+    GetShaderiv = nullptr;
+    GetShaderInfoLog = nullptr;
+    CreateProgram = nullptr;
+    DeleteProgram = nullptr;
+    AttachShader = nullptr;
+    LinkProgram = nullptr;
+    GetProgramiv = nullptr;
+    GetProgramInfoLog = nullptr;
+    UseProgram = nullptr;
+    GetUniformLocation = nullptr;
+    Uniform1i = nullptr;
+    Uniform2f = nullptr;
+    BindAttribLocation = nullptr;
+    VertexAttribPointer = nullptr;
+    EnableVertexAttribArray = nullptr;
+    DisableVertexAttribArray = nullptr;
+}
+
+void GLExtensions::Load()
+{
+    GenBuffers = (PFNGLGENBUFFERSPROC) SDL_GL_GetProcAddress("glGenBuffers");
+    DeleteBuffers = (PFNGLDELETEBUFFERSPROC) SDL_GL_GetProcAddress("glDeleteBuffers");
+    BindBuffer = (PFNGLBINDBUFFERPROC) SDL_GL_GetProcAddress("glBindBuffer");
+    BufferData = (PFNGLBUFFERDATAPROC) SDL_GL_GetProcAddress("glBufferData");
+    MapBuffer = (PFNGLMAPBUFFERPROC) SDL_GL_GetProcAddress("glMapBuffer");
+    UnmapBuffer = (PFNGLUNMAPBUFFERPROC) SDL_GL_GetProcAddress("glUnmapBuffer");
+    MultiDrawElements = (PFNGLMULTIDRAWELEMENTSPROC) SDL_GL_GetProcAddress("glMultiDrawElements");
+    ActiveTexture = (PFNGLACTIVETEXTUREPROC) SDL_GL_GetProcAddress("glActiveTexture");
+
+    // Some platforms return an entry point for anything, so only trust these if the version has them.
+    int major = 0, minor = 0;
+    const char *version = (const char *) glGetString(GL_VERSION);
+
+    if (version && sscanf(version, "%d.%d", &major, &minor) == 2 && (major > 3 || (major == 3 && minor >= 1)))
+        PrimitiveRestartIndex = (PFNGLPRIMITIVERESTARTINDEXPROC) SDL_GL_GetProcAddress("glPrimitiveRestartIndex");
+
+    if (major < 2)
+        return;
+
+    CreateShader = (PFNGLCREATESHADERPROC) SDL_GL_GetProcAddress("glCreateShader");
+    DeleteShader = (PFNGLDELETESHADERPROC) SDL_GL_GetProcAddress("glDeleteShader");
+    ShaderSource = (PFNGLSHADERSOURCEPROC) SDL_GL_GetProcAddress("glShaderSource");
+    CompileShader = (PFNGLCOMPILESHADERPROC) SDL_GL_GetProcAddress("glCompileShader");
+    GetShaderiv = (PFNGLGETSHADERIVPROC) SDL_GL_GetProcAddress("glGetShaderiv");
+    GetShaderInfoLog = (PFNGLGETSHADERINFOLOGPROC) SDL_GL_GetProcAddress("glGetShaderInfoLog");
+    CreateProgram = (PFNGLCREATEPROGRAMPROC) SDL_GL_GetProcAddress("glCreateProgram");
+    DeleteProgram = (PFNGLDELETEPROGRAMPROC) SDL_GL_GetProcAddress("glDeleteProgram");
+    AttachShader = (PFNGLATTACHSHADERPROC) SDL_GL_GetProcAddress("glAttachShader");
+    LinkProgram = (PFNGLLINKPROGRAMPROC) SDL_GL_GetProcAddress("glLinkProgram");
+    GetProgramiv = (PFNGLGETPROGRAMIVPROC) SDL_GL_GetProcAddress("glGetProgramiv");
+    GetProgramInfoLog = (PFNGLGETPROGRAMINFOLOGPROC) SDL_GL_GetProcAddress("glGetProgramInfoLog");
+    UseProgram = (PFNGLUSEPROGRAMPROC) SDL_GL_GetProcAddress("glUseProgram");
+    GetUniformLocation = (PFNGLGETUNIFORMLOCATIONPROC) SDL_GL_GetProcAddress("glGetUniformLocation");
+    Uniform1i = (PFNGLUNIFORM1IPROC) SDL_GL_GetProcAddress("glUniform1i");
+    Uniform2f = (PFNGLUNIFORM2FPROC) SDL_GL_GetProcAddress("glUniform2f");
+    BindAttribLocation = (PFNGLBINDATTRIBLOCATIONPROC) SDL_GL_GetProcAddress("glBindAttribLocation");
+    VertexAttribPointer = (PFNGLVERTEXATTRIBPOINTERPROC) SDL_GL_GetProcAddress("glVertexAttribPointer");
+    EnableVertexAttribArray = (PFNGLENABLEVERTEXATTRIBARRAYPROC) SDL_GL_GetProcAddress("glEnableVertexAttribArray");
+    DisableVertexAttribArray = (PFNGLDISABLEVERTEXATTRIBARRAYPROC) SDL_GL_GetProcAddress("glDisableVertexAttribArray");
+}
@@ -0,0 +1,90 @@
+//  GLExtensions.h
+//  Bryan Turner (original version), Rodrigo Verdiani (SDL version)
+//
+//  Parts of the code in this file were borrowed from numerous public sources &
+//  literature.  I reserve NO rights to this code and give a hearty thank-you to all the
+//  excellent sources used in this project.  These include, but are not limited to:
+//
+//  Longbow Digital Arts Programming Forum (www.LongbowDigitalArts.com)
+//  Gamasutra Features (www.Gamasutra.com)
+//  GameDev References (www.GameDev.net)
+//  C. Cookson's ROAM implementation (C.J.Cookson@dcs.warwick.ac.uk OR cjcookson@hotmail.com)
+//  OpenGL Super Bible (Waite Group Press)
+//  And many more...
+
+
+#ifndef GLEXTENSIONS_H
+#define GLEXTENSIONS_H
+
+#include <SDL_opengl.h>
+
+// GLExtensions Class
+// OpenGL entry points past 1.1.  Windows only exports 1.1, so they are looked up at run time (on every
+// platform, to keep it simple).  A missing one is nullptr, and the renderers that need it fall back to immediate mode.
+class GLExtensions
+{
+public:
+    // Buffer objects (GL 1.5)
+    PFNGLGENBUFFERSPROC GenBuffers;
+    PFNGLDELETEBUFFERSPROC DeleteBuffers;
+    PFNGLBINDBUFFERPROC BindBuffer;
+    PFNGLBUFFERDATAPROC BufferData;
+    PFNGLMAPBUFFERPROC MapBuffer;
+    PFNGLUNMAPBUFFERPROC UnmapBuffer;
+
+    // Drawing several primitives at once (GL 1.4 & GL 3.1)
+    PFNGLMULTIDRAWELEMENTSPROC MultiDrawElements;
+    PFNGLPRIMITIVERESTARTINDEXPROC PrimitiveRestartIndex;
+
+    // Texture units (GL 1.3)
+    PFNGLACTIVETEXTUREPROC ActiveTexture;
+
+    // GLSL programs (GL 2.0)
+    PFNGLCREATESHADERPROC CreateShader;
+    PFNGLDELETESHADERPROC DeleteShader;
+    PFNGLSHADERSOURCEPROC ShaderSource;
+    PFNGLCOMPILESHADERPROC CompileShader;
+    PFNGLGETSHADERIVPROC GetShaderiv;
+    PFNGLGETSHADERINFOLOGPROC GetShaderInfoLog;
+    PFNGLCREATEPROGRAMPROC CreateProgram;
+    PFNGLDELETEPROGRAMPROC DeleteProgram;
+    PFNGLATTACHSHADERPROC AttachShader;
+    PFNGLLINKPROGRAMPROC LinkProgram;
+    PFNGLGETPROGRAMIVPROC GetProgramiv;
+    PFNGLGETPROGRAMINFOLOGPROC GetProgramInfoLog;
+    PFNGLUSEPROGRAMPROC UseProgram;
+    PFNGLGETUNIFORMLOCATIONPROC GetUniformLocation;
+    PFNGLUNIFORM1IPROC Uniform1i;
+    PFNGLUNIFORM2FPROC Uniform2f;
+    PFNGLBINDATTRIBLOCATIONPROC BindAttribLocation;
+    PFNGLVERTEXATTRIBPOINTERPROC VertexAttribPointer;
+    PFNGLENABLEVERTEXATTRIBARRAYPROC EnableVertexAttribArray;
+    PFNGLDISABLEVERTEXATTRIBARRAYPROC DisableVertexAttribArray;
+
+    GLExtensions();
+
+    // Look the entry points up.  Needs a current GL context.
+    void Load();
+
+    bool HasBuffers() const
+    {
+        return GenBuffers && DeleteBuffers && BindBuffer && BufferData && MapBuffer && UnmapBuffer;
+    }
+
+    bool HasShaders() const
+    {
+        return ActiveTexture && CreateShader && DeleteShader && ShaderSource && CompileShader && GetShaderiv &&
+               GetShaderInfoLog && CreateProgram && DeleteProgram && AttachShader && LinkProgram && GetProgramiv &&
+               GetProgramInfoLog && UseProgram && GetUniformLocation && Uniform1i && Uniform2f && BindAttribLocation &&
+               VertexAttribPointer && EnableVertexAttribArray && DisableVertexAttribArray;
+    }
+
+    bool HasPrimitiveRestart() const
+    {
+        return PrimitiveRestartIndex != nullptr;
+    }
+};
+
+extern GLExtensions gGL;
+
+#endif
@@ -14,27 +14,34 @@
 
 #include <SDL.h>
 #include <SDL_opengl.h>
+#include <algorithm>
+#include <chrono>
 #include <cmath>
+#include <cstring>
 
+#include "BudgetController.h"
 #include "Landscape.h"
+#include "MeshRenderer.h"
+#include "VarianceBuilder.h"
 
 // Definition of the static member variables
-int Landscape::m_NextTriNode;
-TriTreeNode Landscape::m_TriPool[POOL_SIZE];
+thread_local TriPool *Landscape::m_ActivePool = nullptr;
 
-// Allocate a TriTreeNode from the pool.
-TriTreeNode *Landscape::AllocateTri()
+Landscape::Landscape() : m_HeightMap(nullptr), m_TriPool(POOL_SIZE), m_VarianceTime(0), m_ResetTime(0), m_TessellateTime(0),
+                         m_NumPasses(0), m_DepthFirstTime(0), m_UsedPriority(false), m_NumVarianceRebuilt(0),
+                         m_VarianceQueueDepth(0)
 {
-    TriTreeNode *pTri;
+}
 
-    // IF we've run out of TriTreeNodes, just return NULL (this is handled gracefully)
-    if (m_NextTriNode >= POOL_SIZE)
-        return nullptr;
+// The worker threads, with gNumThreads of them (0 == one per core).
+ThreadPool *Landscape::GetWorkers()
+{
+    int numThreads = gNumThreads > 0 ? gNumThreads : (int) std::max(1u, std::thread::hardware_concurrency());
 
-    pTri = &(m_TriPool[m_NextTriNode++]);
-    pTri->LeftChild = pTri->RightChild = nullptr;
+    if (!m_Workers || m_Workers->GetNumThreads() != numThreads)
+        m_Workers.reset(new ThreadPool(numThreads));
 
-    return pTri;
+    return m_Workers.get();
 }
 
 // Initialize all patches
@@ -43,6 +50,17 @@ void Landscape::Init(unsigned char *hMap)
     // Store the Height Field array
     m_HeightMap = hMap;
 
+    // Trees down to 8x8 blocks like the original, unless another depth was asked for.
+    int depth = VarianceBuilder::GetDefaultDepth();
+    if (gVarianceDepth > 0)
+        depth = std::min(gVarianceDepth, VarianceBuilder::GetMaxDepth());
+
+    // Use the variance trees of an earlier run of this height map if there are any.
+    uint64_t hash = VarianceCache::HashHeightMap(hMap);
+    bool cached = gUseVarianceCache && m_VarianceCache.Load(hash, depth, gVarianceFormat);
+    if (!cached)
+        m_VarianceCache.Allocate(depth, gVarianceFormat);
+
     // Initialize all terrain patches
     for (int y = 0; y < NUM_PATCHES_PER_SIDE; y++)
     {
@@ -50,15 +68,222 @@ void Landscape::Init(unsigned char *hMap)
         {
             Patch *patch = &(m_Patches[y][x]);
             patch->Init(x * PATCH_SIZE, y * PATCH_SIZE, x * PATCH_SIZE, y * PATCH_SIZE, hMap);
-            patch->ComputeVariance();
+
+            int index = y * NUM_PATCHES_PER_SIDE + x;
+            patch->SetVarianceTrees(m_VarianceCache.GetVarianceLeft(index), m_VarianceCache.GetVarianceRight(index), cached);
+            patch->SetNormalMap(&m_Normals);
         }
     }
+
+    m_Normals.Build(hMap, GetWorkers());
+
+    if (cached)
+        return;
+
+    ComputeVariance();
+
+    if (gUseVarianceCache)
+        m_VarianceCache.Save(hash);
 }
 
-// Reset all patches, recompute variance if needed
-void Landscape::Reset()
+// Share another Landscape's height map, copying its variance trees & normals instead of computing them.
+// The source may already be deformed, so nothing is hashed or written to the cache.  Patches still
+// waiting for new trees in the source are rebuilt here as well.
+void Landscape::Init(const Landscape &source)
+{
+    m_HeightMap = source.m_HeightMap;
+    m_VarianceCache.Copy(source.m_VarianceCache);
+    m_Normals = source.m_Normals;
+
+    for (int y = 0; y < NUM_PATCHES_PER_SIDE; y++)
+    {
+        for (int x = 0; x < NUM_PATCHES_PER_SIDE; x++)
+        {
+            Patch *patch = &(m_Patches[y][x]);
+            patch->Init(x * PATCH_SIZE, y * PATCH_SIZE, x * PATCH_SIZE, y * PATCH_SIZE, m_HeightMap);
+
+            int index = y * NUM_PATCHES_PER_SIDE + x;
+            patch->SetVarianceTrees(m_VarianceCache.GetVarianceLeft(index), m_VarianceCache.GetVarianceRight(index),
+                                    !source.m_Patches[y][x].isDirty());
+            patch->SetNormalMap(&m_Normals);
+        }
+    }
+}
+
+// Recompute the variance trees of the dirty patches, on all the worker threads.
+// Patches only read the height map and write their own variance trees, so they need no locking.
+// With a budget (microseconds, 0 == no limit) the patches nearest the camera go first, one per worker
+// at a time, until the budget is spent; the rest keep their stale trees and wait for the next frame.
+// At least one round is done every frame, so the queue always drains.
+void Landscape::ComputeVariance(int budget)
+{
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    std::chrono::steady_clock::time_point deadline = start + std::chrono::microseconds(budget);
+
+    m_DirtyPatches.clear();
+    m_VarianceTime = 0;
+    m_NumVarianceRebuilt = 0;
+    m_VarianceQueueDepth = 0;
+
+    Patch *patch = &(m_Patches[0][0]);
+    for (int count = 0; count < NUM_PATCHES_PER_SIDE * NUM_PATCHES_PER_SIDE; count++, patch++)
+        if (patch->isDirty())
+            m_DirtyPatches.push_back(patch);
+
+    if (m_DirtyPatches.empty())
+        return;
+
+    // A single patch isn't worth waking the workers for.
+    if (m_DirtyPatches.size() == 1)
+        m_DirtyPatches[0]->ComputeVariance();
+    else if (budget <= 0)
+        GetWorkers()->Run((int) m_DirtyPatches.size(), [this](int task, int)
+        {
+            m_DirtyPatches[task]->ComputeVariance();
+        });
+    else
+    {
+        float eyeX = gViewPosition[0], eyeY = gViewPosition[2];
+        std::sort(m_DirtyPatches.begin(), m_DirtyPatches.end(), [eyeX, eyeY](const Patch *a, const Patch *b)
+        {
+            float aX = a->GetWorldX() + PATCH_SIZE / 2 - eyeX, aY = a->GetWorldY() + PATCH_SIZE / 2 - eyeY;
+            float bX = b->GetWorldX() + PATCH_SIZE / 2 - eyeX, bY = b->GetWorldY() + PATCH_SIZE / 2 - eyeY;
+            return aX * aX + aY * aY < bX * bX + bY * bY;
+        });
+
+        ThreadPool *workers = GetWorkers();
+        int numDirty = (int) m_DirtyPatches.size();
+        int done = 0;
+
+        do
+        {
+            int first = done;
+            int count = std::min(workers->GetNumThreads(), numDirty - done);
+
+            if (count == 1)
+                m_DirtyPatches[first]->ComputeVariance();
+            else
+                workers->Run(count, [this, first](int task, int)
+                {
+                    m_DirtyPatches[first + task]->ComputeVariance();
+                });
+
+            done += count;
+        } while (done < numDirty && std::chrono::steady_clock::now() < deadline);
+
+        m_DirtyPatches.resize(done);
+        m_VarianceQueueDepth = numDirty - done;
+    }
+
+    m_NumVarianceRebuilt = (int) m_DirtyPatches.size();
+    m_VarianceTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Replace the heights of a rectangle of the height map (width x height values, row by row).
+// The variance trees catch up on the next Reset(), recomputing only the nodes over the rectangle.
+void Landscape::Deform(int x, int y, int width, int height, const unsigned char *heights)
+{
+    int minX = std::max(x, 0), maxX = std::min(x + width, MAP_SIZE) - 1;
+    int minY = std::max(y, 0), maxY = std::min(y + height, MAP_SIZE) - 1;
+
+    if (minX > maxX || minY > maxY)
+        return;
+
+    for (int row = minY; row <= maxY; row++)
+        memcpy(&m_HeightMap[row * MAP_SIZE + minX], &heights[(row - y) * width + (minX - x)], maxX - minX + 1);
+
+    // Keep the extra rows of loadTerrain() in step: the one above the map copies the last row,
+    // the one below it copies the first.
+    if (maxY == MAP_SIZE - 1)
+        memcpy(&m_HeightMap[-MAP_SIZE + minX], &m_HeightMap[(MAP_SIZE - 1) * MAP_SIZE + minX], maxX - minX + 1);
+    if (minY == 0)
+        memcpy(&m_HeightMap[MAP_SIZE * MAP_SIZE + minX], &m_HeightMap[minX], maxX - minX + 1);
+
+    MarkDeformed(minX, minY, maxX, maxY);
+    gRenderer.MarkHeightsChanged(minX, minY, maxX, maxY);
+}
+
+// The heights of a rectangle of the map (inclusive) changed: rebuild the variance trees and normals that read
+// them, without touching the heights.  For a Landscape sharing the height map of the one that was deformed.
+void Landscape::MarkDeformed(int minX, int minY, int maxX, int maxY)
+{
+    minX = std::max(minX, 0);
+    minY = std::max(minY, 0);
+    maxX = std::min(maxX, MAP_SIZE - 1);
+    maxY = std::min(maxY, MAP_SIZE - 1);
+
+    if (minX > maxX || minY > maxY)
+        return;
+
+    MarkPatchesDeformed(minX, minY, maxX, maxY);
+    m_Normals.Update(minX, minY, maxX, maxY);
+
+    // The patches on the east & south borders read one sample past the map: x == MAP_SIZE is the
+    // first sample of the next row, and y == MAP_SIZE is the extra row holding a copy of the first.
+    if (minX == 0)
+        MarkPatchesDeformed(MAP_SIZE, minY - 1, MAP_SIZE, maxY - 1);
+    if (minY == 0)
+        MarkPatchesDeformed(minX, MAP_SIZE, maxX, MAP_SIZE);
+    if (minX == 0 && minY == 0)
+        MarkPatchesDeformed(MAP_SIZE, MAP_SIZE - 1, MAP_SIZE, MAP_SIZE - 1);
+}
+
+// Blast a bowl shaped crater into the height map.
+void Landscape::Crater(int centerX, int centerY, int radius, int depth)
+{
+    int size = radius * 2 + 1;
+    std::vector<unsigned char> heights(size * size);
+
+    for (int y = 0; y < size; y++)
+    {
+        for (int x = 0; x < size; x++)
+        {
+            int mapX = std::min(std::max(centerX - radius + x, 0), MAP_SIZE - 1);
+            int mapY = std::min(std::max(centerY - radius + y, 0), MAP_SIZE - 1);
+            int distance2 = (x - radius) * (x - radius) + (y - radius) * (y - radius);
+
+            int height = m_HeightMap[mapY * MAP_SIZE + mapX];
+            if (distance2 < radius * radius)
+                height -= depth * (radius * radius - distance2) / (radius * radius);
+
+            heights[y * size + x] = (unsigned char) std::max(height, 0);
+        }
+    }
+
+    Deform(centerX - radius, centerY - radius, size, size, heights.data());
+}
+
+// Tell every patch that reads a height sample in the rectangle (inclusive, 0..MAP_SIZE) about it.
+void Landscape::MarkPatchesDeformed(int minX, int minY, int maxX, int maxY)
+{
+    minX = std::max(minX, 0);
+    minY = std::max(minY, 0);
+
+    if (minX > maxX || minY > maxY)
+        return;
+
+    // Samples on a patch edge belong to the patches on both sides.
+    int firstX = std::max(0, (minX - 1) / PATCH_SIZE), lastX = std::min(NUM_PATCHES_PER_SIDE - 1, maxX / PATCH_SIZE);
+    int firstY = std::max(0, (minY - 1) / PATCH_SIZE), lastY = std::min(NUM_PATCHES_PER_SIDE - 1, maxY / PATCH_SIZE);
+
+    for (int patchY = firstY; patchY <= lastY; patchY++)
+    {
+        for (int patchX = firstX; patchX <= lastX; patchX++)
+        {
+            int worldX = patchX * PATCH_SIZE, worldY = patchY * PATCH_SIZE;
+
+            if (maxX < worldX || minX > worldX + PATCH_SIZE || maxY < worldY || minY > worldY + PATCH_SIZE)
+                continue;
+
+            m_Patches[patchY][patchX].SetDirty(std::max(minX - worldX, 0), std::max(minY - worldY, 0),
+                                               std::min(maxX - worldX, PATCH_SIZE), std::min(maxY - worldY, PATCH_SIZE));
+        }
+    }
+}
+
+// Perform simple visibility culling on entire patches.
+void Landscape::UpdateVisibility()
 {
-    //  Perform simple visibility culling on entire patches.
     //  - Define a triangle set back from the camera by one patch size, following the angle of the frustum.
     //  - A patch is visible if it's center point is included in the angle: Left,Eye,Right
     //  - This visibility test is only accurate if the camera cannot look up or down significantly.
@@ -75,48 +300,66 @@ void Landscape::Reset()
     int rightX = (int) (eyeX + 100.0f * sinf((gClipAngle + FOV_DIV_2) * PI_DIV_180));
     int rightY = (int) (eyeY - 100.0f * cosf((gClipAngle + FOV_DIV_2) * PI_DIV_180));
 
-    // Set the next free triangle pointer back to the beginning
-    SetNextTriNode(0);
+    for (int y = 0; y < NUM_PATCHES_PER_SIDE; y++)
+        for (int x = 0; x < NUM_PATCHES_PER_SIDE; x++)
+            m_Patches[y][x].SetVisibility(eyeX, eyeY, leftX, leftY, rightX, rightY);
+}
 
-    // Reset rendered triangle count.
-    gNumTrisRendered = 0;
+// Reset all patches, recompute variance if needed
+void Landscape::Reset()
+{
+    // Recompute the variance trees of the patches deformed since last frame, as far as gVarianceBudget goes.
+    ComputeVariance(gVarianceBudget);
 
-    // Go through the patches performing resets, compute variances, and linking.
+    ResetMesh();
+}
+
+// Throw away the mesh, ready to tessellate again.
+void Landscape::ResetMesh()
+{
+    // Release all the TriTreeNodes of the last frame.  The worker pools split the node limit between them.
+    m_TriPool.SetMaxNodes(gMaxNodes);
+    m_TriPool.Reset();
+    for (std::unique_ptr<TriPool> &pool : m_WorkerPools)
+    {
+        pool->SetMaxNodes(gMaxNodes ? std::max(1, gMaxNodes / (int) m_WorkerPools.size()) : 0);
+        pool->Reset();
+    }
+
+    // Go through the patches performing resets.
+    for (int y = 0; y < NUM_PATCHES_PER_SIDE; y++)
+        for (int x = 0; x < NUM_PATCHES_PER_SIDE; x++)
+            m_Patches[y][x].Reset();
+
+    UpdateVisibility();
+
+    // Link all the visible patches together.  Invisible patches are never tessellated, so they are
+    // treated like the border of the landscape.  This keeps the mesh independent of the patch order.
     for (int y = 0; y < NUM_PATCHES_PER_SIDE; y++)
     {
         for (int x = 0; x < NUM_PATCHES_PER_SIDE; x++)
         {
             Patch *patch = &(m_Patches[y][x]);
 
-            // Reset the patch
-            patch->Reset();
-            patch->SetVisibility(eyeX, eyeY, leftX, leftY, rightX, rightY);
-
-            // Check to see if this patch has been deformed since last frame.
-            // If so, recompute the variance tree for it.
-            if (patch->isDirty())
-                patch->ComputeVariance();
-
             if (!patch->isVisibile())
                 continue;
 
-            // Link all the patches together.
-            if (x > 0)
+            if (x > 0 && m_Patches[y][x - 1].isVisibile())
                 patch->GetBaseLeft()->LeftNeighbor = m_Patches[y][x - 1].GetBaseRight();
             else
                 patch->GetBaseLeft()->LeftNeighbor = nullptr; // Link to bordering Landscape here..
 
-            if (x < (NUM_PATCHES_PER_SIDE - 1))
+            if (x < (NUM_PATCHES_PER_SIDE - 1) && m_Patches[y][x + 1].isVisibile())
                 patch->GetBaseRight()->LeftNeighbor = m_Patches[y][x + 1].GetBaseLeft();
             else
                 patch->GetBaseRight()->LeftNeighbor = nullptr;    // Link to bordering Landscape here..
 
-            if (y > 0)
+            if (y > 0 && m_Patches[y - 1][x].isVisibile())
                 patch->GetBaseLeft()->RightNeighbor = m_Patches[y - 1][x].GetBaseRight();
             else
                 patch->GetBaseLeft()->RightNeighbor = nullptr;    // Link to bordering Landscape here..
 
-            if (y < (NUM_PATCHES_PER_SIDE - 1))
+            if (y < (NUM_PATCHES_PER_SIDE - 1) && m_Patches[y + 1][x].isVisibile())
                 patch->GetBaseRight()->RightNeighbor = m_Patches[y + 1][x].GetBaseLeft();
             else
                 patch->GetBaseRight()->RightNeighbor = nullptr; // Link to bordering Landscape here..
@@ -125,33 +368,385 @@ void Landscape::Reset()
 }
 
 // Create an approximate mesh of the landscape.
-void Landscape::Tessellate()
+void Landscape::Tessellate(int budget)
+{
+    // Split into our own pool, whichever thread we're on.
+    m_ActivePool = &m_TriPool;
+
+    m_UsedPriority = (gTessellateOrder == TESSELLATE_PRIORITY);
+
+    if (gTessellateOrder == TESSELLATE_PRIORITY)
+        TessellateByPriority(budget);
+    else if (budget > 0)
+        TessellateWithinBudget(budget);
+    else if (gTessellateOrder == TESSELLATE_PARALLEL)
+        TessellateParallel();
+    else
+    {
+        // Perform Tessellation
+        Patch *patch = &(m_Patches[0][0]);
+        for (int count = 0; count < NUM_PATCHES_PER_SIDE * NUM_PATCHES_PER_SIDE; count++, patch++)
+            if (patch->isVisibile())
+                patch->Tessellate();
+    }
+}
+
+// A time budget needs coarse to fine refinement, so running out of time only loses the finest detail.  The
+// priority heap costs about three times as much per node as the depth first pass though, so patches are
+// tessellated depth first (the parallel order too: same mesh) while that is expected to take less than half the
+// budget.  Should it still reach half the budget, the patches left go coarse to fine.  After that, the depth first
+// pass only comes back once a whole priority pass fits in half the budget: it is cheaper, so it fits too.
+void Landscape::TessellateWithinBudget(int budget)
+{
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    std::chrono::steady_clock::time_point handOff = start + std::chrono::microseconds(budget / 2);
+
+    if (m_DepthFirstTime > (float) (budget / 2))
+    {
+        m_UsedPriority = true;
+        TessellateByPriority(budget);
+
+        // Done before the deadline, so it was not cut short.
+        int elapsed = (int) std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+        if (elapsed < budget)
+            m_DepthFirstTime = (float) elapsed;
+
+        return;
+    }
+
+    int count = 0;
+    for (Patch *patch = &(m_Patches[0][0]); count < NUM_PATCHES_PER_SIDE * NUM_PATCHES_PER_SIDE; count++, patch++)
+    {
+        if (!patch->isVisibile())
+            continue;
+
+        patch->Tessellate();
+
+        if (std::chrono::steady_clock::now() >= handOff)
+            break;
+    }
+
+    int elapsed = (int) std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+
+    if (++count < NUM_PATCHES_PER_SIDE * NUM_PATCHES_PER_SIDE)
+    {
+        m_DepthFirstTime = (float) budget;
+        m_UsedPriority = true;
+        TessellateByPriority(std::max(1, budget - elapsed), count);
+    } else
+        m_DepthFirstTime = (float) elapsed;
+
+    gBudgetUsage = (float) std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count() / (float) budget;
+}
+
+bool Landscape::IsConforming()
 {
-    // Perform Tessellation
     Patch *patch = &(m_Patches[0][0]);
     for (int count = 0; count < NUM_PATCHES_PER_SIDE * NUM_PATCHES_PER_SIDE; count++, patch++)
-        if (patch->isVisibile())
-            patch->Tessellate();
+        if (patch->isVisibile() && !patch->IsConforming())
+            return false;
+
+    return true;
+}
+
+// Build this frame's mesh, tessellating again as long as the budget controller asks for it.
+// With a gTimeBudget, all the passes share it and a pass that runs out of time is the last one.
+// Keeps the time spent in Reset() apart from the passes (the ResetMesh() between them included).
+void Landscape::Update()
+{
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    std::chrono::steady_clock::time_point deadline = start + std::chrono::microseconds(gTimeBudget);
+
+    gController.BeginFrame();
+
+    Reset();
+
+    std::chrono::steady_clock::time_point reset = std::chrono::steady_clock::now();
+    m_NumPasses = 0;
+
+    for (;;)
+    {
+        m_NumPasses++;
+
+        if (gTimeBudget > 0)
+            Tessellate(std::max(1, (int) std::chrono::duration_cast<std::chrono::microseconds>(deadline - std::chrono::steady_clock::now()).count()));
+        else
+            Tessellate();
+
+        if (!gController.Retry(GetNumNodes()) || (gTimeBudget > 0 && std::chrono::steady_clock::now() >= deadline))
+            break;
+
+        ResetMesh();
+    }
+
+    std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+    m_ResetTime = std::chrono::duration<double, std::milli>(reset - start).count();
+    m_TessellateTime = std::chrono::duration<double, std::milli>(end - reset).count();
+
+    if (gTimeBudget > 0)
+        gBudgetUsage = (float) std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count() / (float) gTimeBudget;
+}
+
+// Put a leaf on the priority queue.
+void Landscape::QueueTri(Patch *patch, const VarianceTree *variance, TriTreeNode *tri, int leftX, int leftY,
+                         int rightX, int rightY, int apexX, int apexY, int node, float parentPriority)
+{
+    TessellateEntry entry;
+    entry.Tri = tri;
+    entry.Owner = patch;
+    entry.Variance = variance;
+    entry.LeftX = (short) leftX;
+    entry.LeftY = (short) leftY;
+    entry.RightX = (short) rightX;
+    entry.RightY = (short) rightY;
+    entry.ApexX = (short) apexX;
+    entry.ApexY = (short) apexY;
+    entry.Node = node;
+
+    int centerX = (leftX + rightX) >> 1;
+    int centerY = (leftY + rightY) >> 1;
+
+    // Below the variance tree Patch::RecursTessellate always splits, so just inherit the parent's priority.
+    if (!variance->HasNode(node))
+        entry.Priority = parentPriority;
+    else if (gErrorMetric == METRIC_SCREEN_SPACE)
+        entry.Priority = Patch::ComputePixelError((*variance)[node], centerX, centerY, patch->GetHeight(centerX, centerY));
+    else
+        entry.Priority = Patch::ComputeTriVariance((*variance)[node], centerX, centerY);
+
+    m_Queue.push_back(entry);
+    std::push_heap(m_Queue.begin(), m_Queue.end());
+}
+
+// Create an approximate mesh of the landscape, splitting the triangle with the most projected error first.
+// Stops at the frame variance or pixel tolerance (same mesh as Tessellate()), when the pool runs out of nodes
+// (gMaxNodes) or when budget microseconds are spent (0 == no limit), whichever comes first, so a small node or
+// time budget goes to the nearest, roughest terrain instead of the first patches.  Every split leaves a
+// conforming mesh.  gDesiredTris is left to the budget controller, which has to see the real node count.
+// Only the patches from firstPatch on (y * NUM_PATCHES_PER_SIDE + x) are queued, the ones before it are done.
+void Landscape::TessellateByPriority(int budget, int firstPatch)
+{
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    std::chrono::steady_clock::time_point deadline = start + std::chrono::microseconds(budget);
+    float threshold = (gErrorMetric == METRIC_SCREEN_SPACE) ? gPixelTolerance : gFrameVariance;
+    int numPopped = 0;
+
+    m_Queue.clear();
+
+    for (int y = firstPatch / NUM_PATCHES_PER_SIDE; y < NUM_PATCHES_PER_SIDE; y++)
+    {
+        for (int x = (y == firstPatch / NUM_PATCHES_PER_SIDE) ? firstPatch % NUM_PATCHES_PER_SIDE : 0; x < NUM_PATCHES_PER_SIDE; x++)
+        {
+            Patch *patch = &(m_Patches[y][x]);
+            if (!patch->isVisibile())
+                continue;
+
+            int worldX = patch->GetWorldX();
+            int worldY = patch->GetWorldY();
+
+            QueueTri(patch, &patch->GetVarianceLeft(), patch->GetBaseLeft(), worldX, worldY + PATCH_SIZE,
+                     worldX + PATCH_SIZE, worldY, worldX, worldY, 1, 0.0f);
+            QueueTri(patch, &patch->GetVarianceRight(), patch->GetBaseRight(), worldX + PATCH_SIZE, worldY,
+                     worldX, worldY + PATCH_SIZE, worldX + PATCH_SIZE, worldY + PATCH_SIZE, 1, 0.0f);
+        }
+    }
+
+    while (!m_Queue.empty())
+    {
+        std::pop_heap(m_Queue.begin(), m_Queue.end());
+        TessellateEntry entry = m_Queue.back();
+        m_Queue.pop_back();
+
+        if (entry.Priority <= threshold)
+            break;
+
+        // Reading the clock costs about as much as a split, so only look at it now and then.
+        if (budget > 0 && (++numPopped % BUDGET_CHECK_INTERVAL) == 0 && std::chrono::steady_clock::now() >= deadline)
+            break;
+
+        // The triangle may already have been force split by a neighbor, then only its children are left to do.
+        if (!entry.Tri->LeftChild)
+        {
+            entry.Owner->Split(entry.Tri);
+
+            // Out of nodes.
+            if (!entry.Tri->LeftChild)
+                break;
+        }
+
+        // Tessellate all the way down to one vertex per height field entry
+        if ((abs(entry.LeftX - entry.RightX) >= 3) || (abs(entry.LeftY - entry.RightY) >= 3))
+        {
+            int centerX = (entry.LeftX + entry.RightX) >> 1;
+            int centerY = (entry.LeftY + entry.RightY) >> 1;
+
+            QueueTri(entry.Owner, entry.Variance, entry.Tri->LeftChild, entry.ApexX, entry.ApexY,
+                     entry.LeftX, entry.LeftY, centerX, centerY, entry.Node << 1, entry.Priority);
+            QueueTri(entry.Owner, entry.Variance, entry.Tri->RightChild, entry.RightX, entry.RightY,
+                     entry.ApexX, entry.ApexY, centerX, centerY, 1 + (entry.Node << 1), entry.Priority);
+        }
+    }
+
+    if (budget > 0)
+        gBudgetUsage = (float) std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count() / (float) budget;
+}
+
+// Tessellate the visible patches on several threads, then stitch them together.
+// Each patch is cut loose from its neighbors and tessellated on its own, with a node pool per thread,
+// so forced splits never cross into a patch another thread is working on.  StitchPatches() then adds
+// the forced splits across the patch borders, giving exactly the mesh of the serial Tessellate().
+void Landscape::TessellateParallel()
+{
+    ThreadPool *workers = GetWorkers();
+    int numThreads = workers->GetNumThreads();
+
+    while ((int) m_WorkerPools.size() < numThreads)
+    {
+        m_WorkerPools.emplace_back(new TriPool(POOL_SIZE / numThreads));
+        m_WorkerPools.back()->SetMaxNodes(gMaxNodes ? std::max(1, gMaxNodes / numThreads) : 0);
+    }
+
+    m_VisiblePatches.clear();
+
+    Patch *patch = &(m_Patches[0][0]);
+    for (int count = 0; count < NUM_PATCHES_PER_SIDE * NUM_PATCHES_PER_SIDE; count++, patch++)
+    {
+        if (!patch->isVisibile())
+            continue;
+
+        // Cut the links to the neighboring patches.  StitchPatches() restores them.
+        patch->GetBaseLeft()->LeftNeighbor = patch->GetBaseLeft()->RightNeighbor = nullptr;
+        patch->GetBaseRight()->LeftNeighbor = patch->GetBaseRight()->RightNeighbor = nullptr;
+
+        m_VisiblePatches.push_back(patch);
+    }
+
+    workers->Run((int) m_VisiblePatches.size(), [this](int task, int worker)
+    {
+        m_ActivePool = m_WorkerPools[worker].get();
+        m_VisiblePatches[task]->Tessellate();
+        m_ActivePool = &m_TriPool;
+    });
+
+    // Stitching takes what the workers left of the node limit (at least 1, 0 would be no limit).
+    if (gMaxNodes)
+        m_TriPool.SetMaxNodes(std::max(1, gMaxNodes - (GetNumNodes() - m_TriPool.GetNumAllocated())));
+
+    StitchPatches();
 }
 
-// Render each patch of the landscape & adjust the frame variance.
+// Walk the leaf edges on both sides of a border between two patches.  Edges that meet are linked to each other,
+// so later splits of those leaves force their neighbors across the border like in the serial pass.  Where the
+// edges don't meet, split the leaf with the longer edge (the split the serial pass would have forced across
+// the border).  Returns true if anything was split, false once the edges meet or the node limit is reached.
+bool Landscape::StitchBorder(Patch *patchA, int borderA, Patch *patchB, int borderB)
+{
+    m_BorderA.clear();
+    m_BorderB.clear();
+
+    patchA->CollectBorder(borderA, m_BorderA);
+    patchB->CollectBorder(borderB, m_BorderB);
+
+    auto byPosition = [](const BorderEdge &a, const BorderEdge &b) { return a.From < b.From; };
+    std::sort(m_BorderA.begin(), m_BorderA.end(), byPosition);
+    std::sort(m_BorderB.begin(), m_BorderB.end(), byPosition);
+
+    bool split = false;
+    size_t a = 0, b = 0;
+
+    while (a < m_BorderA.size() && b < m_BorderB.size())
+    {
+        BorderEdge &edgeA = m_BorderA[a];
+        BorderEdge &edgeB = m_BorderB[b];
+
+        if (edgeA.To == edgeB.To)
+        {
+            *edgeA.Link = edgeB.Tri;
+            *edgeB.Link = edgeA.Tri;
+
+            a++;
+            b++;
+        } else if (edgeA.To > edgeB.To)
+        {
+            patchA->Split(edgeA.Tri);
+            split = split || edgeA.Tri->LeftChild;
+
+            while (b < m_BorderB.size() && m_BorderB[b].To <= edgeA.To)
+                b++;
+            a++;
+        } else
+        {
+            patchB->Split(edgeB.Tri);
+            split = split || edgeB.Tri->LeftChild;
+
+            while (a < m_BorderA.size() && m_BorderA[a].To <= edgeB.To)
+                a++;
+            b++;
+        }
+    }
+
+    return split;
+}
+
+// Make the separately tessellated patches conform along their borders and link them together.
+// Each border is walked until both sides meet everywhere.  From then on it is linked, so splits made while
+// stitching the other borders keep it conforming through Patch::Split(), and one pass is enough.
+void Landscape::StitchPatches()
+{
+    for (int y = 0; y < NUM_PATCHES_PER_SIDE; y++)
+    {
+        for (int x = 0; x < NUM_PATCHES_PER_SIDE; x++)
+        {
+            Patch *patch = &(m_Patches[y][x]);
+            if (!patch->isVisibile())
+                continue;
+
+            if (x < (NUM_PATCHES_PER_SIDE - 1) && m_Patches[y][x + 1].isVisibile())
+                while (StitchBorder(patch, BORDER_EAST, &(m_Patches[y][x + 1]), BORDER_WEST));
+
+            if (y < (NUM_PATCHES_PER_SIDE - 1) && m_Patches[y + 1][x].isVisibile())
+                while (StitchBorder(patch, BORDER_SOUTH, &(m_Patches[y + 1][x]), BORDER_NORTH));
+        }
+    }
+}
+
+// Nodes allocated this frame, by every thread.
+int Landscape::GetNumNodes() const
+{
+    int numNodes = m_TriPool.GetNumAllocated();
+    for (const std::unique_ptr<TriPool> &pool : m_WorkerPools)
+        numNodes += pool->GetNumAllocated();
+
+    return numNodes;
+}
+
+// Render each patch of the landscape.
 void Landscape::Render()
 {
     Patch *patch = &(m_Patches[0][0]);
 
+    // Reset rendered triangle count.
+    gNumTrisRendered = 0;
+
     // Scale the terrain by the terrain scale specified at compile time.
     glScalef(1.0f, MULT_SCALE, 1.0f);
 
+    gRenderer.Begin();
+
     for (int count = 0; count < NUM_PATCHES_PER_SIDE * NUM_PATCHES_PER_SIDE; count++, patch++)
         if (patch->isVisibile())
             patch->Render();
 
-    // Check to see if we got close to the desired number of triangles.
-    // Adjust the frame variance to a better value.
-    if (GetNextTriNode() != gDesiredTris)
-        gFrameVariance += ((float) GetNextTriNode() - (float) gDesiredTris) / (float) gDesiredTris;
+    gRenderer.End();
+}
+
+// Check to see if we got close to the desired number of triangles.
+// Adjust the frame variance to a better value.
+void Landscape::AdjustFrameVariance()
+{
+    // The screen space metric refines to gPixelTolerance, the triangle count just follows.
+    if (gErrorMetric == METRIC_SCREEN_SPACE)
+        return;
 
-    // Bounds checking.
-    if (gFrameVariance < 0)
-        gFrameVariance = 0;
+    gController.EndFrame(GetNumNodes());
 }
@@ -16,7 +16,14 @@
 #define LANDSCAPE_H
 
 #include <SDL_opengl.h>
+#include <memory>
+#include <vector>
+
+#include "NormalMap.h"
 #include "Patch.h"
+#include "ThreadPool.h"
+#include "TriPool.h"
+#include "VarianceCache.h"
 
 // Various Pre-Defined map sizes & their #define counterparts:
 
@@ -45,9 +52,13 @@
 // etc..
 #define MULT_SCALE 0.5f
 
-// How many TriTreeNodes should be allocated?
+// How many TriTreeNodes should be allocated up front?
+// The pool grows on demand past this, so this is only a starting point (see the high-water mark printed at exit).
 #define POOL_SIZE 25000
 
+// A time budgeted tessellation reads the clock every this many triangles.
+#define BUDGET_CHECK_INTERVAL 32
+
 // Some more definitions
 #define PATCH_SIZE (MAP_SIZE / NUM_PATCHES_PER_SIDE)
 #define TEXTURE_SIZE 128
@@ -61,6 +72,30 @@ enum DRAWING_MODES
     DRAW_USE_WIREFRAME
 };
 
+// Tessellation Engines
+enum TESSELLATION_ENGINES
+{
+    ENGINE_PER_FRAME = 0,        // Rebuild the mesh from the base triangles every frame
+    ENGINE_SPLIT_MERGE,            // Keep last frame's mesh and refine it with split/merge queues
+    ENGINE_PIPELINED            // Rebuild the next frame's mesh on a worker thread while this one is drawn
+};
+
+// Tessellation Orders (for the per-frame engine)
+enum TESSELLATION_ORDERS
+{
+    TESSELLATE_DEPTH_FIRST = 0,    // Patch by patch, each one recursively
+    TESSELLATE_PRIORITY,        // Whole landscape at once, highest projected error first
+    TESSELLATE_PARALLEL            // Patch by patch on gNumThreads threads, then stitched (same mesh as depth first)
+};
+
+// Error Metrics (split test of the depth first & parallel tessellation)
+enum ERROR_METRICS
+{
+    METRIC_DISTANCE = 0,        // variance * MAP_SIZE * 2 / (1 + distance) > gFrameVariance
+    METRIC_SQUARED_DISTANCE,    // Same test on squared distances: no sqrt, no division
+    METRIC_SCREEN_SPACE            // Variance projected to pixels with the real projection > gPixelTolerance
+};
+
 // Rotation Indexes
 enum ROTATION_INDEXES
 {
@@ -74,14 +109,44 @@ enum ROTATION_INDEXES
 // External variables and functions:
 extern GLuint gTextureID;
 extern int gDrawMode;
+extern int gEngine;
+extern int gTessellateOrder;
+extern int gNumThreads;
+extern int gErrorMetric;
+extern float gPixelTolerance;
+extern int gViewportWidth;
 extern GLfloat gViewPosition[];
 extern GLfloat gCameraRotation[];
 extern GLfloat gClipAngle;
 extern float gFrameVariance;
 extern int gDesiredTris;
+extern int gMaxNodes;
 extern int gNumTrisRendered;
+extern int gUseVarianceCache;
+extern int gVarianceDepth;
+extern int gVarianceFormat;
+extern int gVarianceBudget;
+extern int gTimeBudget;
+extern float gBudgetUsage;
 extern float gFovX;
 
+// TessellateEntry Struct
+// A leaf waiting to be split by the priority ordered tessellation.
+struct TessellateEntry
+{
+    float Priority;                                                    // Projected error of the triangle
+    TriTreeNode *Tri;
+    Patch *Owner;                                                    // Patch the triangle belongs to
+    const VarianceTree *Variance;                                    // Variance tree of its base triangle
+    short LeftX, LeftY, RightX, RightY, ApexX, ApexY;                // World coordinates of the corners
+    int Node;                                                        // Index in the variance tree (may be below it)
+
+    bool operator<(const TessellateEntry &other) const
+    {
+        return Priority < other.Priority;
+    }
+};
+
 // Landscape Class
 // Holds all the information to render an entire landscape.
 class Landscape
@@ -89,27 +154,157 @@ class Landscape
 protected:
     unsigned char *m_HeightMap;                                        // HeightMap of the Landscape
     Patch m_Patches[NUM_PATCHES_PER_SIDE][NUM_PATCHES_PER_SIDE];    // Array of patches
+    VarianceCache m_VarianceCache;                                    // Variance trees of all the patches
+    NormalMap m_Normals;                                            // Normals of the height map, for lighting
+
+    TriPool m_TriPool;                                                // Pool of TriTree nodes for splitting
+    static thread_local TriPool *m_ActivePool;                        // Pool AllocateTri() uses on this thread
+
+    std::vector<TessellateEntry> m_Queue;                            // Leaves to split (max-heap), for TESSELLATE_PRIORITY
 
-    static int m_NextTriNode;                                        // Index to next free TriTreeNode
-    static TriTreeNode m_TriPool[POOL_SIZE];                        // Pool of TriTree nodes for splitting
+    std::unique_ptr<ThreadPool> m_Workers;                            // Threads for TESSELLATE_PARALLEL
+    std::vector<std::unique_ptr<TriPool>> m_WorkerPools;            // One node pool per worker thread
+    std::vector<Patch *> m_VisiblePatches;                            // Patches handed out to the workers
+    std::vector<BorderEdge> m_BorderA, m_BorderB;                    // Scratch space for StitchBorder()
+    std::vector<Patch *> m_DirtyPatches;                            // Patches handed out by ComputeVariance()
+    double m_VarianceTime;                                            // Milliseconds the last ComputeVariance() took
+    double m_ResetTime;                                                // Milliseconds the last Update() spent in Reset()
+    double m_TessellateTime;                                        // ... and in its tessellation passes
+    int m_NumPasses;                                                // Tessellation passes the last Update() made
+    float m_DepthFirstTime;                                            // Microseconds a whole depth first pass is expected to take
+    bool m_UsedPriority;                                            // Did the last Tessellate() go (partly) coarse to fine?
+    int m_NumVarianceRebuilt;                                        // Patches it rebuilt
+    int m_VarianceQueueDepth;                                        // Dirty patches it left for the next frame
 
-    static int GetNextTriNode()
+    ThreadPool *GetWorkers();
+
+    void QueueTri(Patch *patch, const VarianceTree *variance, TriTreeNode *tri, int leftX, int leftY,
+                  int rightX, int rightY, int apexX, int apexY, int node, float parentPriority);
+
+    void MarkPatchesDeformed(int minX, int minY, int maxX, int maxY);
+    void TessellateWithinBudget(int budget);
+
+    bool StitchBorder(Patch *patchA, int borderA, Patch *patchB, int borderB);
+    void StitchPatches();
+
+public:
+    Landscape();
+
+    // Allocate from the pool of the Landscape being tessellated on this thread.
+    static TriTreeNode *AllocateTri()
     {
-        return m_NextTriNode;
+        return m_ActivePool->Allocate();
     }
 
-    static void SetNextTriNode(int nNextNode)
+    static bool HasRoom(int count)
     {
-        m_NextTriNode = nNextNode;
+        return m_ActivePool->HasRoom(count);
     }
 
-public:
-    static TriTreeNode *AllocateTri();
+    TriPool &GetTriPool()
+    {
+        return m_TriPool;
+    }
+
+    Patch *GetPatch(int x, int y)
+    {
+        return &(m_Patches[y][x]);
+    }
+
+    unsigned char *GetHeightMap()
+    {
+        return m_HeightMap;
+    }
+
+    // Nodes allocated this frame, by every thread.
+    int GetNumNodes() const;
+
+    double GetVarianceTime() const
+    {
+        return m_VarianceTime;
+    }
+
+    double GetResetTime() const
+    {
+        return m_ResetTime;
+    }
+
+    double GetTessellateTime() const
+    {
+        return m_TessellateTime;
+    }
+
+    int GetNumPasses() const
+    {
+        return m_NumPasses;
+    }
+
+    bool UsedPriority() const
+    {
+        return m_UsedPriority;
+    }
+
+    int GetNumVarianceRebuilt() const
+    {
+        return m_NumVarianceRebuilt;
+    }
+
+    // Patches whose variance trees the last ComputeVariance() rebuilt.
+    const std::vector<Patch *> &GetRebuiltPatches() const
+    {
+        return m_DirtyPatches;
+    }
+
+    int GetVarianceQueueDepth() const
+    {
+        return m_VarianceQueueDepth;
+    }
+
+    int GetVarianceDepth() const
+    {
+        return m_VarianceCache.GetDepth();
+    }
+
+    int GetVarianceFormat() const
+    {
+        return m_VarianceCache.GetFormat();
+    }
+
+    // Bytes taken by the variance trees of all the patches.
+    size_t GetVarianceMemory() const
+    {
+        return m_VarianceCache.GetDataSize();
+    }
+
+    const NormalMap &GetNormalMap() const
+    {
+        return m_Normals;
+    }
+
+    // Were the variance trees mapped from the cache file by Init()?
+    bool IsVarianceCached() const
+    {
+        return m_VarianceCache.IsMapped();
+    }
 
     virtual void Init(unsigned char *hMap);
+    virtual void Init(const Landscape &source);
+    virtual void ComputeVariance(int budget = 0);
+    virtual void Deform(int x, int y, int width, int height, const unsigned char *heights);
+    virtual void MarkDeformed(int minX, int minY, int maxX, int maxY);
+    virtual void Crater(int centerX, int centerY, int radius, int depth);
+    virtual void UpdateVisibility();
     virtual void Reset();
-    virtual void Tessellate();
+    virtual void ResetMesh();
+    virtual bool IsConforming();
+    virtual void Tessellate(int budget = 0);
+    virtual void TessellateByPriority(int budget = 0, int firstPatch = 0);
+    virtual void TessellateParallel();
+    virtual void Update();
     virtual void Render();
+    virtual void AdjustFrameVariance();
 };
 
+extern Landscape gLand;
+
 #endif
\ No newline at end of file
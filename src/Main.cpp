@@ -12,10 +12,92 @@
 //  OpenGL Super Bible (Waite Group Press)
 //  And many more...
 
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+
 #include "App.h"
+#include "Benchmark.h"
+#include "BudgetController.h"
+#include "Landscape.h"
+#include "MeshRenderer.h"
 
 int main(int argc, char *argv[])
 {
+    const char *benchmark = nullptr;
+    bool headless = false;
+    int frames = 0;
+
+    // Command line: roamsdl [--threads <n>] [--no-cache] [--variance-depth <n>] [--variance-16] [--variance-budget <us>] [--budget <us>] [--max-nodes <n>]
+    //                      [--controller nudge|pid|bisection] [--gains <kp> <ki> <kd>]
+    //                      [--render-path immediate|stream|indexed|strips|displaced|packed] [--draw-mode texture|lighting|fill|wireframe]
+    //                      [--bench-<name> [frames] | --headless [frames]]
+    for (int i = 1; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "--threads") && i + 1 < argc)
+            gNumThreads = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--no-cache"))
+            gUseVarianceCache = 0;
+        else if (!strcmp(argv[i], "--variance-depth") && i + 1 < argc)
+            gVarianceDepth = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--variance-16"))
+            gVarianceFormat = VARIANCE_16BIT;
+        else if (!strcmp(argv[i], "--variance-budget") && i + 1 < argc)
+            gVarianceBudget = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--budget") && i + 1 < argc)
+            gTimeBudget = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--max-nodes") && i + 1 < argc)
+            gMaxNodes = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--controller") && i + 1 < argc)
+        {
+            i++;
+            if (!strcmp(argv[i], "nudge"))
+                gController.SetMode(CONTROLLER_NUDGE);
+            else if (!strcmp(argv[i], "pid"))
+                gController.SetMode(CONTROLLER_PID);
+            else
+                gController.SetMode(CONTROLLER_BISECTION);
+        } else if (!strcmp(argv[i], "--gains") && i + 3 < argc)
+        {
+            gController.SetGains((float) atof(argv[i + 1]), (float) atof(argv[i + 2]), (float) atof(argv[i + 3]));
+            i += 3;
+        } else if (!strcmp(argv[i], "--render-path") && i + 1 < argc)
+        {
+            const char *names[] = {"immediate", "stream", "indexed", "strips", "displaced", "packed"};
+
+            i++;
+            for (int path = RENDER_IMMEDIATE; path <= RENDER_PACKED; path++)
+                if (!strcmp(argv[i], names[path]))
+                    gRenderPath = path;
+        } else if (!strcmp(argv[i], "--draw-mode") && i + 1 < argc)
+        {
+            const char *names[] = {"texture", "lighting", "fill", "wireframe"};
+
+            i++;
+            for (int mode = DRAW_USE_TEXTURE; mode <= DRAW_USE_WIREFRAME; mode++)
+                if (!strcmp(argv[i], names[mode]))
+                    gDrawMode = mode;
+        }
+        else if (!strncmp(argv[i], "--bench-", 8))
+        {
+            benchmark = argv[i] + 8;
+            if (i + 1 < argc && isdigit((unsigned char) argv[i + 1][0]))
+                frames = atoi(argv[++i]);
+        }
+        else if (!strcmp(argv[i], "--headless"))
+        {
+            headless = true;
+            if (i + 1 < argc && isdigit((unsigned char) argv[i + 1][0]))
+                frames = atoi(argv[++i]);
+        }
+    }
+
+    if (benchmark)
+        return runBenchmark(benchmark, frames) ? 0 : 1;
+
+    if (headless)
+        return runHeadless(frames) ? 0 : 1;
+
     App app;
 
     app.Init();
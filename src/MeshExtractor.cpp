@@ -0,0 +1,281 @@
+//  MeshExtractor.cpp
+//  Bryan Turner (original version), Rodrigo Verdiani (SDL version)
+//
+//  Parts of the code in this file were borrowed from numerous public sources &
+//  literature.  I reserve NO rights to this code and give a hearty thank-you to all the
+//  excellent sources used in this project.  These include, but are not limited to:
+//
+//  Longbow Digital Arts Programming Forum (www.LongbowDigitalArts.com)
+//  Gamasutra Features (www.Gamasutra.com)
+//  GameDev References (www.GameDev.net)
+//  C. Cookson's ROAM implementation (C.J.Cookson@dcs.warwick.ac.uk OR cjcookson@hotmail.com)
+//  OpenGL Super Bible (Waite Group Press)
+//  And many more...
+
+
+#include <algorithm>
+#include <thread>
+
+#include "Landscape.h"
+#include "MeshExtractor.h"
+
+IndexedMesh::IndexedMesh() : Vertices(nullptr), Indices(nullptr), VertexCapacity(0), IndexCapacity(0), NumVertices(0),
+                             NumIndices(0), NumTriangles(0), Slots((PATCH_SIZE + 1) * (PATCH_SIZE + 1)),
+                             Stamps((PATCH_SIZE + 1) * (PATCH_SIZE + 1), 0), Stamp(0), Format(VERTEX_FULL), Strips(false),
+                             StripStart(-1), HasPending(false)
+{
+}
+
+void IndexedMesh::Begin(void *out, int capacity, GLushort *indices, int indexCapacity)
+{
+    Vertices = out;
+    Indices = indices;
+    VertexCapacity = capacity;
+    IndexCapacity = indexCapacity;
+    NumVertices = 0;
+    NumIndices = 0;
+    NumTriangles = 0;
+
+    StripRanges.clear();
+    StripStart = -1;
+    HasPending = false;
+
+    // A new stamp forgets the vertices of the last patch without clearing the table.
+    if (++Stamp == 0)
+    {
+        std::fill(Stamps.begin(), Stamps.end(), 0);
+        Stamp = 1;
+    }
+}
+
+void IndexedMesh::OpenStrip(int a, int b, int c)
+{
+    StripStart = NumIndices;
+
+    Emit(a);
+    Emit(b);
+    Emit(c);
+
+    Tail[0] = a;
+    Tail[1] = b;
+    Tail[2] = c;
+}
+
+// Generalized strips: the leaves come in an order where each one shares an edge with the last (see
+// Patch::RecursExtractIndexed()).  Sharing the last edge of the strip takes one index, the other edge with its newest
+// vertex takes three (a swap: two degenerate triangles turn the strip around).  The winding stays right by itself,
+// as neighbours in a consistently wound mesh run their shared edge in opposite directions.
+void IndexedMesh::AddTriangle(int a, int b, int c)
+{
+    NumTriangles++;
+
+    if (!Strips)
+    {
+        Emit(a);
+        Emit(b);
+        Emit(c);
+        return;
+    }
+
+    int tri[3] = {a, b, c};
+
+    // Start a strip with the pending triangle, turned so that it ends on the edge shared with this one.
+    if (HasPending)
+    {
+        HasPending = false;
+
+        for (int rotation = 0; rotation < 3; rotation++)
+        {
+            int first = Pending[rotation], second = Pending[(rotation + 1) % 3], third = Pending[(rotation + 2) % 3];
+
+            if (std::count(tri, tri + 3, second) && std::count(tri, tri + 3, third))
+            {
+                OpenStrip(first, second, third);
+                break;
+            }
+        }
+
+        if (StripStart < 0)
+        {
+            OpenStrip(Pending[0], Pending[1], Pending[2]);
+            EndStrip();
+        }
+    }
+
+    if (StripStart < 0)
+    {
+        Pending[0] = a;
+        Pending[1] = b;
+        Pending[2] = c;
+        HasPending = true;
+        return;
+    }
+
+    bool hasOldest = std::count(tri, tri + 3, Tail[0]) > 0;
+    bool hasMiddle = std::count(tri, tri + 3, Tail[1]) > 0;
+    bool hasNewest = std::count(tri, tri + 3, Tail[2]) > 0;
+
+    if (hasNewest && hasMiddle)
+    {
+        int third = a + b + c - Tail[1] - Tail[2];
+        Emit(third);
+
+        Tail[0] = Tail[1];
+        Tail[1] = Tail[2];
+        Tail[2] = third;
+        return;
+    }
+
+    if (hasNewest && hasOldest)
+    {
+        int third = a + b + c - Tail[0] - Tail[2];
+        Emit(Tail[2]);
+        Emit(Tail[0]);
+        Emit(third);
+
+        int oldest = Tail[0];
+        Tail[0] = Tail[2];
+        Tail[1] = oldest;
+        Tail[2] = third;
+        return;
+    }
+
+    EndStrip();
+
+    Pending[0] = a;
+    Pending[1] = b;
+    Pending[2] = c;
+    HasPending = true;
+}
+
+void IndexedMesh::EndStrip()
+{
+    if (HasPending)
+    {
+        HasPending = false;
+        OpenStrip(Pending[0], Pending[1], Pending[2]);
+    }
+
+    if (StripStart < 0)
+        return;
+
+    StripRanges.push_back(StripStart);
+    StripRanges.push_back(NumIndices - StripStart);
+    Emit(STRIP_RESTART_INDEX);
+
+    StripStart = -1;
+}
+
+MeshExtractor::MeshExtractor() : m_NumMeshes(0), m_Format(VERTEX_FULL), m_Indexed(false), m_Strips(false),
+                                 m_Fingerprint(false)
+{
+}
+
+// The worker threads, with gNumThreads of them (0 == one per core).  A pool of its own, as one renderer draws
+// every engine.
+ThreadPool *MeshExtractor::GetWorkers()
+{
+    int numThreads = gNumThreads > 0 ? gNumThreads : (int) std::max(1u, std::thread::hardware_concurrency());
+
+    if (!m_Workers || m_Workers->GetNumThreads() != numThreads)
+    {
+        m_Workers.reset(new ThreadPool(numThreads));
+
+        m_Tables.clear();
+        for (int i = 0; i < numThreads; i++)
+            m_Tables.emplace_back(new IndexedMesh);
+    }
+
+    return m_Workers.get();
+}
+
+void MeshExtractor::Begin(int format, bool indexed, bool strips, bool fingerprint)
+{
+    m_NumMeshes = 0;
+    m_Format = format;
+    m_Indexed = indexed;
+    m_Strips = strips;
+    m_Fingerprint = fingerprint;
+}
+
+PatchMesh &MeshExtractor::Add(Patch *patch, TriTreeNode *baseLeft, TriTreeNode *baseRight)
+{
+    if (m_NumMeshes == (int) m_Meshes.size())
+        m_Meshes.emplace_back();
+
+    PatchMesh &mesh = m_Meshes[m_NumMeshes++];
+    mesh.Source = patch;
+    mesh.BaseLeft = baseLeft;
+    mesh.BaseRight = baseRight;
+    mesh.CachedShape = nullptr;
+
+    return mesh;
+}
+
+// Write one patch, growing its buffers until it fits.
+void MeshExtractor::ExtractMesh(PatchMesh &mesh, IndexedMesh &table)
+{
+    mesh.Written = true;
+
+    if (m_Fingerprint)
+    {
+        mesh.Source->Fingerprint(mesh.BaseLeft, mesh.BaseRight, mesh.Shape);
+
+        if (mesh.CachedShape && *mesh.CachedShape == mesh.Shape)
+        {
+            mesh.Written = false;
+            return;
+        }
+    }
+
+    size_t vertexSize = IndexedMesh::GetVertexSize(m_Format);
+
+    if (!m_Indexed)
+    {
+        int capacity = (int) (mesh.Vertices.size() / vertexSize);
+        int count = mesh.Source->Extract(mesh.BaseLeft, mesh.BaseRight, (StreamVertex *) mesh.Vertices.data(), capacity);
+
+        if (count > capacity)
+        {
+            mesh.Vertices.resize((size_t) count * vertexSize);
+            mesh.Source->Extract(mesh.BaseLeft, mesh.BaseRight, (StreamVertex *) mesh.Vertices.data(), count);
+        }
+
+        mesh.Count = count;
+        mesh.NumIndices = count;
+        mesh.NumTriangles = count / 3;
+        mesh.StripRanges.clear();
+        return;
+    }
+
+    table.Format = m_Format;
+    table.Strips = m_Strips;
+    table.Begin(mesh.Vertices.data(), (int) (mesh.Vertices.size() / vertexSize), mesh.Indices.data(),
+                (int) mesh.Indices.size());
+    mesh.Source->ExtractIndexed(mesh.BaseLeft, mesh.BaseRight, table);
+
+    if (table.NumVertices > table.VertexCapacity || table.NumIndices > table.IndexCapacity)
+    {
+        mesh.Vertices.resize(std::max(mesh.Vertices.size(), (size_t) table.NumVertices * vertexSize));
+        mesh.Indices.resize(std::max(mesh.Indices.size(), (size_t) table.NumIndices));
+
+        table.Begin(mesh.Vertices.data(), (int) (mesh.Vertices.size() / vertexSize), mesh.Indices.data(),
+                    (int) mesh.Indices.size());
+        mesh.Source->ExtractIndexed(mesh.BaseLeft, mesh.BaseRight, table);
+    }
+
+    mesh.Count = table.NumVertices;
+    mesh.NumIndices = table.NumIndices;
+    mesh.NumTriangles = table.NumTriangles;
+    mesh.StripRanges.swap(table.StripRanges);
+}
+
+void MeshExtractor::Extract()
+{
+    ThreadPool *workers = GetWorkers();
+
+    workers->Run(m_NumMeshes, [this](int task, int worker)
+    {
+        ExtractMesh(m_Meshes[task], *m_Tables[worker]);
+    });
+}
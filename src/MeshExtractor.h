@@ -0,0 +1,193 @@
+//  MeshExtractor.h
+//  Bryan Turner (original version), Rodrigo Verdiani (SDL version)
+//
+//  Parts of the code in this file were borrowed from numerous public sources &
+//  literature.  I reserve NO rights to this code and give a hearty thank-you to all the
+//  excellent sources used in this project.  These include, but are not limited to:
+//
+//  Longbow Digital Arts Programming Forum (www.LongbowDigitalArts.com)
+//  Gamasutra Features (www.Gamasutra.com)
+//  GameDev References (www.GameDev.net)
+//  C. Cookson's ROAM implementation (C.J.Cookson@dcs.warwick.ac.uk OR cjcookson@hotmail.com)
+//  OpenGL Super Bible (Waite Group Press)
+//  And many more...
+
+
+#ifndef MESHEXTRACTOR_H
+#define MESHEXTRACTOR_H
+
+#include <SDL_opengl.h>
+#include <memory>
+#include <vector>
+
+#include "Patch.h"
+#include "ThreadPool.h"
+
+// Index that ends a triangle strip (a patch has far fewer vertices).
+#define STRIP_RESTART_INDEX 0xFFFF
+
+// Vertex Formats (of an IndexedMesh)
+enum VERTEX_FORMATS
+{
+    VERTEX_FULL = 0,             // StreamVertex
+    VERTEX_GRID,                 // GridVertex
+    VERTEX_PACKED,               // PackedVertex
+    VERTEX_PACKED_LIT            // PackedVertex followed by its normal, as NormalMap::GetPacked() has it
+};
+
+// StreamVertex Struct
+// A vertex of the streaming renderer, in patch coordinates.
+struct StreamVertex
+{
+    GLfloat X, Y, Z;
+    GLubyte Color[4];
+    GLfloat Normal[3];                                            // Only written with DRAW_USE_LIGHTING
+};
+
+// GridVertex Struct
+// A vertex of RENDER_DISPLACED: just the grid point, in patch coordinates.  Height, color & normal are
+// worked out from the height map texture on the GPU.
+struct GridVertex
+{
+    GLshort X, Y;
+};
+
+// PackedVertex Struct
+// A vertex of RENDER_PACKED, in patch coordinates: a patch is PATCH_SIZE + 1 grid points across and heights are bytes
+// already, so the whole vertex fits in 4 bytes.
+struct PackedVertex
+{
+    GLubyte X, Height, Y;
+    GLubyte Shade;                                                // Gray level of the color
+};
+
+// IndexedMesh Struct
+// Where Patch::ExtractIndexed() writes a patch: every grid point used once, and the triangles as indices into them,
+// either as a list or as triangle strips ended by STRIP_RESTART_INDEX.
+// The counts keep going past the capacities, so the caller can tell how much room the patch needs.
+struct IndexedMesh
+{
+    void *Vertices;                                                // In one of the VERTEX_FORMATS, see Format
+    GLushort *Indices;
+    int VertexCapacity, IndexCapacity;
+    int NumVertices, NumIndices;
+    int NumTriangles;
+
+    std::vector<int> Slots;                                        // Vertex of each grid point, (PATCH_SIZE + 1)^2 of them
+    std::vector<unsigned int> Stamps;                            // Slots[i] is only valid if Stamps[i] == Stamp
+    unsigned int Stamp;
+
+    int Format;                                                    // One of VERTEX_FORMATS
+    bool Strips;                                                // Write strips instead of a list
+    std::vector<int> StripRanges;                                // First index & count of every strip written
+    int StripStart;                                                // First index of the open strip, -1 if none
+    int Tail[3];                                                // Its last three vertices
+    int Pending[3];                                                // Triangle waiting for the next one to start a strip
+    bool HasPending;
+
+    IndexedMesh();
+
+    static size_t GetVertexSize(int format)
+    {
+        switch (format)
+        {
+            case VERTEX_GRID:
+                return sizeof(GridVertex);
+            case VERTEX_PACKED:
+                return sizeof(PackedVertex);
+            case VERTEX_PACKED_LIT:
+                return sizeof(PackedVertex) + 4;
+            default:
+                return sizeof(StreamVertex);
+        }
+    }
+
+    // Start writing a patch to out & indices.
+    void Begin(void *out, int capacity, GLushort *indices, int indexCapacity);
+
+    // Add a triangle (counter clockwise), to the open strip if it shares the right edge with its last triangle.
+    void AddTriangle(int a, int b, int c);
+
+    // Close the open strip.  Call it once the patch is written.
+    void EndStrip();
+
+protected:
+    void Emit(int index)
+    {
+        if (NumIndices < IndexCapacity)
+            Indices[NumIndices] = (GLushort) index;
+
+        NumIndices++;
+    }
+
+    void OpenStrip(int a, int b, int c);
+};
+
+// PatchMesh Struct
+// The mesh of one patch, written by MeshExtractor for the GL stage to draw.
+struct PatchMesh
+{
+    Patch *Source;
+    TriTreeNode *BaseLeft, *BaseRight;
+    const std::vector<unsigned int> *CachedShape;                // If set, skip the patch when its shape is still this one
+
+    std::vector<unsigned int> Shape;                            // Patch::Fingerprint(), with Fingerprint set
+    bool Written;                                                // False if CachedShape still held
+    std::vector<unsigned char> Vertices;                        // In the format of the extractor
+    std::vector<GLushort> Indices;                                // Unless it writes plain triangles
+    std::vector<int> StripRanges;                                // See IndexedMesh
+    int Count, NumIndices, NumTriangles;
+
+    PatchMesh() : Source(nullptr), BaseLeft(nullptr), BaseRight(nullptr), CachedShape(nullptr), Written(false), Count(0),
+                  NumIndices(0), NumTriangles(0)
+    {
+    }
+};
+
+// MeshExtractor Class
+// The CPU half of drawing a frame: the patches are queued with Add(), then Extract() writes each one to buffers of
+// its own, spread over gNumThreads threads.  Nothing here touches the GL, so it also runs without a context.
+class MeshExtractor
+{
+protected:
+    std::vector<PatchMesh> m_Meshes;                            // Kept from frame to frame, so their buffers are too
+    int m_NumMeshes;
+    std::vector<std::unique_ptr<IndexedMesh>> m_Tables;            // Grid point table of each worker
+    std::unique_ptr<ThreadPool> m_Workers;
+
+    int m_Format;                                                // One of VERTEX_FORMATS
+    bool m_Indexed, m_Strips, m_Fingerprint;
+
+    ThreadPool *GetWorkers();
+    void ExtractMesh(PatchMesh &mesh, IndexedMesh &table);
+
+public:
+    MeshExtractor();
+
+    // Start a frame.  indexed == ExtractIndexed() (as strips or not) instead of Extract(), which only has VERTEX_FULL.
+    // fingerprint == work out the shape of every patch too, for the geometry cache.
+    void Begin(int format, bool indexed, bool strips, bool fingerprint);
+
+    // Queue a mesh of a patch.  The mesh returned stays valid until the next Begin() or Add().
+    PatchMesh &Add(Patch *patch, TriTreeNode *baseLeft, TriTreeNode *baseRight);
+
+    // Write every queued mesh, on the worker threads.
+    void Extract();
+
+    int GetNumMeshes() const
+    {
+        return m_NumMeshes;
+    }
+
+    PatchMesh &GetMesh(int index)
+    {
+        return m_Meshes[index];
+    }
+
+    int GetVertexSize() const
+    {
+        return (int) IndexedMesh::GetVertexSize(m_Format);
+    }
+};
+
+#endif
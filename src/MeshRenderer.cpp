@@ -0,0 +1,698 @@
+//  MeshRenderer.cpp
+//  Bryan Turner (original version), Rodrigo Verdiani (SDL version)
+//
+//  Parts of the code in this file were borrowed from numerous public sources &
+//  literature.  I reserve NO rights to this code and give a hearty thank-you to all the
+//  excellent sources used in this project.  These include, but are not limited to:
+//
+//  Longbow Digital Arts Programming Forum (www.LongbowDigitalArts.com)
+//  Gamasutra Features (www.Gamasutra.com)
+//  GameDev References (www.GameDev.net)
+//  C. Cookson's ROAM implementation (C.J.Cookson@dcs.warwick.ac.uk OR cjcookson@hotmail.com)
+//  OpenGL Super Bible (Waite Group Press)
+//  And many more...
+
+
+#include <algorithm>
+#include <cstddef>
+#include <iostream>
+#include <string>
+
+#include "GLExtensions.h"
+#include "Landscape.h"
+#include "MeshRenderer.h"
+
+MeshRenderer::MeshRenderer() : m_Buffer(0), m_IndexBuffer(0), m_Path(RENDER_IMMEDIATE), m_Capacity(STREAM_BUFFER_VERTICES),
+                               m_IndexCapacity(STREAM_BUFFER_INDICES), m_VertexSize(sizeof(StreamVertex)), m_Vertices(nullptr),
+                               m_Indices(nullptr), m_Collecting(false), m_HeightMap(nullptr), m_HeightTexture(0),
+                               m_DirtyMinX(1), m_DirtyMinY(1), m_DirtyMaxX(0), m_DirtyMaxY(0), m_Shader(nullptr),
+                               m_Caching(false), m_CacheHits(0), m_CacheLookups(0), m_Restart(false)
+{
+}
+
+// The vertex shader of the shader paths.  RENDER_DISPLACED (DISPLACED defined) reads the height of a grid point from
+// the height map texture, exactly (GL_NEAREST at the texel center), and makes its normal from the heights around the
+// sample it came from as NormalMap::BuildSample() does.  RENDER_PACKED gets them from the vertex.  The rest does what the fixed function
+// pipeline does for the other paths (see SetupRC() & SetDrawModeContext()): the color of Patch.cpp, object linear
+// texture coordinates in patch space, and light 0.
+static const char *s_VertexShader =
+    "uniform vec2 Origin;\n"
+    "uniform bool Lighting;\n"
+    "\n"
+    "#ifdef DISPLACED\n"
+    "uniform sampler2D Heights;\n"
+    "\n"
+    "float Height(vec2 grid)\n"
+    "{\n"
+    "    return texture2DLod(Heights, (grid + 0.5) / (MAP_SIZE + 1.0), 0.0).r * 255.0;\n"
+    "}\n"
+    "#else\n"
+    "attribute vec4 Packed;\n"
+    "attribute vec3 Normal;\n"
+    "#endif\n"
+    "\n"
+    "void main()\n"
+    "{\n"
+    "#ifdef DISPLACED\n"
+    "    vec2 grid = Origin + gl_Vertex.xy;\n"
+    "    float height = Height(grid);\n"
+    "    vec4 position = vec4(gl_Vertex.x, height, gl_Vertex.y, 1.0);\n"
+    "    float shade = floor(min(1.0, (60.0 + height) / 256.0) * 255.0 + 0.5) / 255.0;\n"
+    "#else\n"
+    "    vec4 position = vec4(Packed.xyz, 1.0);\n"
+    "    float shade = Packed.w / 255.0;\n"
+    "#endif\n"
+    "\n"
+    "    gl_Position = gl_ModelViewProjectionMatrix * (position + vec4(Origin.x, 0.0, Origin.y, 0.0));\n"
+    "    gl_TexCoord[0] = vec4(dot(gl_ObjectPlaneS[0], position), dot(gl_ObjectPlaneT[0], position), 0.0, 1.0);\n"
+    "    gl_FrontColor = vec4(shade, shade, shade, 1.0);\n"
+    "\n"
+    "    if (Lighting)\n"
+    "    {\n"
+    "#ifdef DISPLACED\n"
+    "        float index = min(grid.y * MAP_SIZE + grid.x, MAP_SIZE * (MAP_SIZE + 1.0) - 1.0);\n"
+    "        vec2 center = vec2(mod(index, MAP_SIZE), mod(floor(index / MAP_SIZE), MAP_SIZE));\n"
+    "        vec2 low = max(center - 1.0, 0.0), high = min(center + 1.0, MAP_SIZE - 1.0);\n"
+    "        float a = (Height(vec2(low.x, center.y)) - Height(vec2(high.x, center.y))) / (high.x - low.x);\n"
+    "        float b = (Height(vec2(center.x, low.y)) - Height(vec2(center.x, high.y))) / (high.y - low.y);\n"
+    "        vec3 normal = gl_NormalMatrix * normalize(vec3(a, 1.0, b));\n"
+    "#else\n"
+    "        vec3 normal = gl_NormalMatrix * (Normal / 127.0);\n"
+    "#endif\n"
+    "\n"
+    "        float diffuse = max(dot(normal, normalize(gl_LightSource[0].position.xyz)), 0.0);\n"
+    "        vec3 light = gl_LightModel.ambient.rgb + gl_LightSource[0].ambient.rgb + diffuse * gl_LightSource[0].diffuse.rgb;\n"
+    "\n"
+    "        gl_FrontColor.rgb = min(shade * light, 1.0);\n"
+    "    }\n"
+    "}\n";
+
+// GL_MODULATE, as set up in roamInit().
+static const char *s_FragmentShader =
+    "uniform sampler2D Texture;\n"
+    "uniform bool Texturing;\n"
+    "\n"
+    "void main()\n"
+    "{\n"
+    "    gl_FragColor = Texturing ? gl_Color * texture2D(Texture, gl_TexCoord[0].st) : gl_Color;\n"
+    "}\n";
+
+static GLuint CompileShader(GLenum type, const std::string &source)
+{
+    GLuint shader = gGL.CreateShader(type);
+    const GLchar *text = source.c_str();
+
+    gGL.ShaderSource(shader, 1, &text, nullptr);
+    gGL.CompileShader(shader);
+
+    GLint compiled = GL_FALSE;
+    gGL.GetShaderiv(shader, GL_COMPILE_STATUS, &compiled);
+
+    if (!compiled)
+    {
+        GLchar log[1024] = "";
+        gGL.GetShaderInfoLog(shader, sizeof(log), nullptr, log);
+        std::cout << "Vertex shader paths: " << log << std::endl;
+
+        gGL.DeleteShader(shader);
+        return 0;
+    }
+
+    return shader;
+}
+
+bool MeshRenderer::LoadProgram(ShaderProgram &shader, bool displaced)
+{
+    // Whatever happens, only try once.
+    shader.Failed = true;
+
+    GLint vertexTextures = 0;
+    if (gGL.HasShaders())
+        glGetIntegerv(GL_MAX_VERTEX_TEXTURE_IMAGE_UNITS, &vertexTextures);
+
+    if (!gGL.HasShaders() || (displaced && (!m_HeightMap || vertexTextures < 1)))
+    {
+        std::cout << (displaced ? "Displacement: no vertex shader texture reads" : "Packed vertices: no GLSL")
+                  << ", drawing triangle strips instead" << std::endl;
+        return false;
+    }
+
+    std::string header = "#version 120\n#define MAP_SIZE " + std::to_string(MAP_SIZE) + ".0\n";
+    if (displaced)
+        header += "#define DISPLACED\n";
+
+    GLuint vertexShader = CompileShader(GL_VERTEX_SHADER, header + s_VertexShader);
+    GLuint fragmentShader = CompileShader(GL_FRAGMENT_SHADER, header + s_FragmentShader);
+
+    if (!vertexShader || !fragmentShader)
+    {
+        gGL.DeleteShader(vertexShader);
+        gGL.DeleteShader(fragmentShader);
+        return false;
+    }
+
+    GLuint program = gGL.CreateProgram();
+    gGL.AttachShader(program, vertexShader);
+    gGL.AttachShader(program, fragmentShader);
+
+    // Packed has to be attribute 0, the one that stands for the vertex position.
+    if (!displaced)
+    {
+        gGL.BindAttribLocation(program, PACKED_ATTRIBUTE, "Packed");
+        gGL.BindAttribLocation(program, NORMAL_ATTRIBUTE, "Normal");
+    }
+
+    gGL.LinkProgram(program);
+
+    // The program keeps them alive.
+    gGL.DeleteShader(vertexShader);
+    gGL.DeleteShader(fragmentShader);
+
+    GLint linked = GL_FALSE;
+    gGL.GetProgramiv(program, GL_LINK_STATUS, &linked);
+
+    if (!linked)
+    {
+        GLchar log[1024] = "";
+        gGL.GetProgramInfoLog(program, sizeof(log), nullptr, log);
+        std::cout << "Vertex shader paths: " << log << std::endl;
+
+        gGL.DeleteProgram(program);
+        return false;
+    }
+
+    shader.OriginLocation = gGL.GetUniformLocation(program, "Origin");
+    shader.LightingLocation = gGL.GetUniformLocation(program, "Lighting");
+    shader.TexturingLocation = gGL.GetUniformLocation(program, "Texturing");
+
+    // The landscape texture stays on unit 0, the heights go to unit 1.
+    gGL.UseProgram(program);
+    gGL.Uniform1i(gGL.GetUniformLocation(program, "Texture"), 0);
+    if (displaced)
+        gGL.Uniform1i(gGL.GetUniformLocation(program, "Heights"), 1);
+    gGL.UseProgram(0);
+
+    shader.Program = program;
+    shader.Failed = false;
+
+    return true;
+}
+
+void MeshRenderer::MarkHeightsChanged(int minX, int minY, int maxX, int maxY)
+{
+    // Texel (MAP_SIZE, y) is sample (0, y + 1) and row MAP_SIZE copies row 0: see UploadHeights().  They take their
+    // normals from those samples as well, which also depend on column & row 1.
+    if (minX <= 1)
+    {
+        minY = std::max(minY - 1, 0);
+        maxX = MAP_SIZE;
+    }
+
+    if (minY <= 1)
+        maxY = MAP_SIZE;
+
+    // The cached meshes over it, and the ones around it whose normals changed, are out of date.
+    for (auto &entry : m_Cache)
+    {
+        PatchCache &cache = entry.second;
+
+        if (cache.WorldX <= maxX + 1 && cache.WorldX + PATCH_SIZE >= minX - 1 && cache.WorldY <= maxY + 1 &&
+            cache.WorldY + PATCH_SIZE >= minY - 1)
+            cache.Path = -1;
+    }
+
+    if (m_DirtyMinX > m_DirtyMaxX)
+    {
+        m_DirtyMinX = minX;
+        m_DirtyMinY = minY;
+        m_DirtyMaxX = maxX;
+        m_DirtyMaxY = maxY;
+        return;
+    }
+
+    m_DirtyMinX = std::min(m_DirtyMinX, minX);
+    m_DirtyMinY = std::min(m_DirtyMinY, minY);
+    m_DirtyMaxX = std::max(m_DirtyMaxX, maxX);
+    m_DirtyMaxY = std::max(m_DirtyMaxY, maxY);
+}
+
+// Upload the whole height map the first time, then only what was deformed since.  The texture is left bound to
+// unit 1, where nothing else goes.
+void MeshRenderer::UploadHeights()
+{
+    int minX = 0, minY = 0, maxX = MAP_SIZE, maxY = MAP_SIZE;
+
+    if (m_HeightTexture)
+    {
+        if (m_DirtyMinX > m_DirtyMaxX)
+            return;
+
+        minX = m_DirtyMinX;
+        minY = m_DirtyMinY;
+        maxX = m_DirtyMaxX;
+        maxY = m_DirtyMaxY;
+    }
+
+    // Texel (x, y) is the sample Patch reads for that grid point, x == MAP_SIZE being the first of the next row.
+    // The very last one would be past the padding row of loadTerrain(), so it repeats the one before.
+    int width = maxX - minX + 1, height = maxY - minY + 1;
+    int last = MAP_SIZE * (MAP_SIZE + 1) - 1;
+    std::vector<unsigned char> texels(width * height);
+
+    for (int y = minY; y <= maxY; y++)
+        for (int x = minX; x <= maxX; x++)
+            texels[(y - minY) * width + (x - minX)] = m_HeightMap[std::min(y * MAP_SIZE + x, last)];
+
+    gGL.ActiveTexture(GL_TEXTURE1);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+    if (!m_HeightTexture)
+    {
+        glGenTextures(1, &m_HeightTexture);
+        glBindTexture(GL_TEXTURE_2D, m_HeightTexture);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_LUMINANCE8, width, height, 0, GL_LUMINANCE, GL_UNSIGNED_BYTE, texels.data());
+    }
+    else
+        glTexSubImage2D(GL_TEXTURE_2D, 0, minX, minY, width, height, GL_LUMINANCE, GL_UNSIGNED_BYTE, texels.data());
+
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    gGL.ActiveTexture(GL_TEXTURE0);
+
+    m_DirtyMinX = m_DirtyMinY = 1;
+    m_DirtyMaxX = m_DirtyMaxY = 0;
+}
+
+bool MeshRenderer::PrepareShader()
+{
+    ShaderProgram &shader = (m_Path == RENDER_DISPLACED) ? m_Displacement : m_Packing;
+
+    if (!shader.Program && (shader.Failed || !LoadProgram(shader, m_Path == RENDER_DISPLACED)))
+        return false;
+
+    if (m_Path == RENDER_DISPLACED)
+        UploadHeights();
+
+    m_Shader = &shader;
+    return true;
+}
+
+// Orphan the buffers, so the driver can hand out fresh memory while the GPU still draws the old contents, and map them.
+// They grow to hold a frame.
+bool MeshRenderer::Map(int numVertices, int numIndices)
+{
+    while (m_Capacity < numVertices)
+        m_Capacity *= 2;
+
+    while (m_IndexCapacity < numIndices)
+        m_IndexCapacity *= 2;
+
+    if (!m_Buffer)
+        gGL.GenBuffers(1, &m_Buffer);
+
+    gGL.BindBuffer(GL_ARRAY_BUFFER, m_Buffer);
+    gGL.BufferData(GL_ARRAY_BUFFER, (GLsizeiptr) m_Capacity * m_VertexSize, nullptr, GL_STREAM_DRAW);
+    m_Vertices = (unsigned char *) gGL.MapBuffer(GL_ARRAY_BUFFER, GL_WRITE_ONLY);
+
+    if (m_Vertices && m_Path != RENDER_STREAM)
+    {
+        if (!m_IndexBuffer)
+            gGL.GenBuffers(1, &m_IndexBuffer);
+
+        gGL.BindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_IndexBuffer);
+        gGL.BufferData(GL_ELEMENT_ARRAY_BUFFER, (GLsizeiptr) m_IndexCapacity * sizeof(GLushort), nullptr, GL_STREAM_DRAW);
+        m_Indices = (GLushort *) gGL.MapBuffer(GL_ELEMENT_ARRAY_BUFFER, GL_WRITE_ONLY);
+
+        if (!m_Indices)
+        {
+            gGL.UnmapBuffer(GL_ARRAY_BUFFER);
+            m_Vertices = nullptr;
+        }
+    }
+
+    return m_Vertices != nullptr;
+}
+
+void MeshRenderer::Begin()
+{
+    m_CacheHits = 0;
+    m_CacheLookups = 0;
+
+    if (gRenderPath == RENDER_IMMEDIATE || !gGL.HasBuffers())
+        return;
+
+    m_Path = gRenderPath;
+
+    m_Shader = nullptr;
+    if ((m_Path == RENDER_DISPLACED || m_Path == RENDER_PACKED) && !PrepareShader())
+        m_Path = RENDER_STRIPS;
+
+    int format = VERTEX_FULL;
+    if (m_Path == RENDER_DISPLACED)
+        format = VERTEX_GRID;
+    else if (m_Path == RENDER_PACKED)
+        format = (gDrawMode == DRAW_USE_LIGHTING) ? VERTEX_PACKED_LIT : VERTEX_PACKED;
+
+    m_VertexSize = (int) IndexedMesh::GetVertexSize(format);
+    m_Caching = gGeometryCache != 0;
+
+    // Cached patches only need their shape, unless it changed.
+    m_Extractor.Begin(format, m_Path != RENDER_STREAM, m_Path >= RENDER_STRIPS, m_Caching);
+    m_Collecting = true;
+}
+
+void MeshRenderer::DrawPatch(Patch *patch, TriTreeNode *baseLeft, TriTreeNode *baseRight)
+{
+    m_Extractor.Add(patch, baseLeft, baseRight);
+}
+
+// Copy the patches to the streaming buffers and draw them.
+void MeshRenderer::Submit()
+{
+    m_Extractor.Extract();
+
+    int numMeshes = m_Extractor.GetNumMeshes();
+    int numVertices = 0, numIndices = 0;
+
+    for (int i = 0; i < numMeshes; i++)
+    {
+        numVertices += m_Extractor.GetMesh(i).Count;
+        numIndices += m_Extractor.GetMesh(i).NumIndices;
+    }
+
+    // No buffer to write to: fall back to immediate mode, now that m_Collecting is off.
+    if (!Map(numVertices, numIndices))
+    {
+        for (int i = 0; i < numMeshes; i++)
+        {
+            PatchMesh &mesh = m_Extractor.GetMesh(i);
+            mesh.Source->Render(mesh.BaseLeft, mesh.BaseRight);
+        }
+
+        return;
+    }
+
+    int first = 0, firstIndex = 0;
+
+    for (int i = 0; i < numMeshes; i++)
+    {
+        const PatchMesh &mesh = m_Extractor.GetMesh(i);
+
+        PatchDraw draw;
+        draw.WorldX = mesh.Source->GetWorldX();
+        draw.WorldY = mesh.Source->GetWorldY();
+        draw.First = first;
+        draw.Count = mesh.Count;
+        draw.FirstIndex = firstIndex;
+        draw.NumIndices = mesh.NumIndices;
+        draw.FirstStrip = (int) m_StripCounts.size();
+        draw.NumStrips = (int) mesh.StripRanges.size() / 2;
+
+        std::copy(mesh.Vertices.begin(), mesh.Vertices.begin() + (size_t) mesh.Count * m_VertexSize,
+                  m_Vertices + (size_t) first * m_VertexSize);
+
+        if (m_Path != RENDER_STREAM)
+        {
+            std::copy(mesh.Indices.begin(), mesh.Indices.begin() + mesh.NumIndices, m_Indices + firstIndex);
+            firstIndex += mesh.NumIndices;
+        }
+
+        for (size_t strip = 0; strip < mesh.StripRanges.size(); strip += 2)
+        {
+            m_StripOffsets.push_back((const GLvoid *) ((draw.FirstIndex + mesh.StripRanges[strip]) * sizeof(GLushort)));
+            m_StripCounts.push_back(mesh.StripRanges[strip + 1]);
+        }
+
+        m_Draws.push_back(draw);
+
+        first += mesh.Count;
+        gNumTrisRendered += mesh.NumTriangles;
+    }
+
+    Flush();
+}
+
+// Draw each patch from its cache entry, writing the entry first unless it holds this very mesh.  Looking at the shape
+// of the trees is all it takes when it does: no vertices to work out, nothing to upload.
+void MeshRenderer::SubmitCached()
+{
+    int numMeshes = m_Extractor.GetNumMeshes();
+
+    // Looked up here, the workers only read the entries.
+    m_Entries.resize(numMeshes);
+    for (int i = 0; i < numMeshes; i++)
+    {
+        PatchMesh &mesh = m_Extractor.GetMesh(i);
+        PatchCache &cache = m_Cache[mesh.BaseLeft];
+
+        m_Entries[i] = &cache;
+        mesh.CachedShape = (cache.Path == m_Path && cache.DrawMode == gDrawMode) ? &cache.Shape : nullptr;
+    }
+
+    m_Extractor.Extract();
+
+    BeginDraws();
+
+    for (int i = 0; i < numMeshes; i++)
+    {
+        PatchMesh &mesh = m_Extractor.GetMesh(i);
+        PatchCache &cache = *m_Entries[i];
+
+        m_CacheLookups++;
+
+        if (mesh.Written)
+            WriteCache(cache, mesh);
+        else
+            m_CacheHits++;
+
+        PatchDraw draw;
+        draw.WorldX = cache.WorldX;
+        draw.WorldY = cache.WorldY;
+        draw.First = 0;
+        draw.Count = cache.Count;
+        draw.FirstIndex = 0;
+        draw.NumIndices = cache.NumIndices;
+        draw.FirstStrip = 0;
+        draw.NumStrips = (int) cache.StripCounts.size();
+
+        gGL.BindBuffer(GL_ARRAY_BUFFER, cache.VertexBuffer);
+
+        if (m_Path != RENDER_STREAM)
+            gGL.BindBuffer(GL_ELEMENT_ARRAY_BUFFER, cache.IndexBuffer);
+
+        SetVertexArrays(0);
+        DrawMesh(draw, cache.StripCounts.data(), cache.StripOffsets.data());
+
+        gNumTrisRendered += cache.NumTriangles;
+    }
+
+    EndDraws();
+}
+
+void MeshRenderer::WriteCache(PatchCache &cache, PatchMesh &mesh)
+{
+    cache.Count = mesh.Count;
+    cache.NumIndices = mesh.NumIndices;
+    cache.NumTriangles = mesh.NumTriangles;
+
+    cache.StripCounts.clear();
+    cache.StripOffsets.clear();
+
+    for (size_t strip = 0; strip < mesh.StripRanges.size(); strip += 2)
+    {
+        cache.StripOffsets.push_back((const GLvoid *) (mesh.StripRanges[strip] * sizeof(GLushort)));
+        cache.StripCounts.push_back(mesh.StripRanges[strip + 1]);
+    }
+
+    if (!cache.VertexBuffer)
+        gGL.GenBuffers(1, &cache.VertexBuffer);
+
+    gGL.BindBuffer(GL_ARRAY_BUFFER, cache.VertexBuffer);
+    gGL.BufferData(GL_ARRAY_BUFFER, (GLsizeiptr) cache.Count * m_VertexSize, mesh.Vertices.data(), GL_STATIC_DRAW);
+
+    if (m_Path != RENDER_STREAM)
+    {
+        if (!cache.IndexBuffer)
+            gGL.GenBuffers(1, &cache.IndexBuffer);
+
+        gGL.BindBuffer(GL_ELEMENT_ARRAY_BUFFER, cache.IndexBuffer);
+        gGL.BufferData(GL_ELEMENT_ARRAY_BUFFER, (GLsizeiptr) cache.NumIndices * sizeof(GLushort), mesh.Indices.data(),
+                       GL_STATIC_DRAW);
+    }
+
+    cache.Shape.swap(mesh.Shape);
+    cache.Path = m_Path;
+    cache.DrawMode = gDrawMode;
+    cache.WorldX = mesh.Source->GetWorldX();
+    cache.WorldY = mesh.Source->GetWorldY();
+}
+
+// Point the vertex arrays at the first vertex of a patch, so its indices can stay 16 bit.
+void MeshRenderer::SetVertexArrays(int first)
+{
+    const char *base = (const char *) (size_t) (first * m_VertexSize);
+
+    if (m_Path == RENDER_DISPLACED)
+    {
+        glVertexPointer(2, GL_SHORT, sizeof(GridVertex), base);
+        return;
+    }
+
+    if (m_Path == RENDER_PACKED)
+    {
+        gGL.VertexAttribPointer(PACKED_ATTRIBUTE, 4, GL_UNSIGNED_BYTE, GL_FALSE, m_VertexSize, base);
+
+        if (gDrawMode == DRAW_USE_LIGHTING)
+            gGL.VertexAttribPointer(NORMAL_ATTRIBUTE, 3, GL_BYTE, GL_FALSE, m_VertexSize, base + sizeof(PackedVertex));
+
+        return;
+    }
+
+    glVertexPointer(3, GL_FLOAT, sizeof(StreamVertex), base + offsetof(StreamVertex, X));
+    glColorPointer(4, GL_UNSIGNED_BYTE, sizeof(StreamVertex), base + offsetof(StreamVertex, Color));
+
+    if (gDrawMode == DRAW_USE_LIGHTING)
+        glNormalPointer(GL_FLOAT, sizeof(StreamVertex), base + offsetof(StreamVertex, Normal));
+}
+
+void MeshRenderer::BeginDraws()
+{
+    if (m_Shader)
+    {
+        gGL.UseProgram(m_Shader->Program);
+        gGL.Uniform1i(m_Shader->LightingLocation, gDrawMode == DRAW_USE_LIGHTING);
+        gGL.Uniform1i(m_Shader->TexturingLocation, gDrawMode == DRAW_USE_TEXTURE);
+    }
+
+    if (m_Path == RENDER_PACKED)
+    {
+        gGL.EnableVertexAttribArray(PACKED_ATTRIBUTE);
+
+        if (gDrawMode == DRAW_USE_LIGHTING)
+            gGL.EnableVertexAttribArray(NORMAL_ATTRIBUTE);
+    }
+    else
+        glEnableClientState(GL_VERTEX_ARRAY);
+
+    if (!m_Shader)
+    {
+        glEnableClientState(GL_COLOR_ARRAY);
+
+        if (gDrawMode == DRAW_USE_LIGHTING)
+            glEnableClientState(GL_NORMAL_ARRAY);
+    }
+
+    m_Restart = (m_Path >= RENDER_STRIPS) && gGL.HasPrimitiveRestart();
+    if (m_Restart)
+    {
+        glEnable(GL_PRIMITIVE_RESTART);
+        gGL.PrimitiveRestartIndex(STRIP_RESTART_INDEX);
+    }
+}
+
+// Draw a patch whose vertex arrays are set.  Its strips start at stripCounts & stripOffsets.
+void MeshRenderer::DrawMesh(const PatchDraw &draw, const GLsizei *stripCounts, const GLvoid *const *stripOffsets)
+{
+    // The shader adds the patch position itself.
+    if (m_Shader)
+        gGL.Uniform2f(m_Shader->OriginLocation, (GLfloat) draw.WorldX, (GLfloat) draw.WorldY);
+    else
+    {
+        glPushMatrix();
+        glTranslatef((GLfloat) draw.WorldX, 0, (GLfloat) draw.WorldY);
+    }
+
+    const GLvoid *indices = (const GLvoid *) (size_t) (draw.FirstIndex * sizeof(GLushort));
+
+    if (m_Path == RENDER_STREAM)
+        glDrawArrays(GL_TRIANGLES, draw.First, draw.Count);
+    else if (m_Path == RENDER_INDEXED)
+        glDrawElements(GL_TRIANGLES, draw.NumIndices, GL_UNSIGNED_SHORT, indices);
+    else if (m_Restart)
+        glDrawElements(GL_TRIANGLE_STRIP, draw.NumIndices, GL_UNSIGNED_SHORT, indices);
+    else if (gGL.MultiDrawElements)
+        gGL.MultiDrawElements(GL_TRIANGLE_STRIP, stripCounts, GL_UNSIGNED_SHORT, stripOffsets, draw.NumStrips);
+    else
+    {
+        for (int strip = 0; strip < draw.NumStrips; strip++)
+            glDrawElements(GL_TRIANGLE_STRIP, stripCounts[strip], GL_UNSIGNED_SHORT, stripOffsets[strip]);
+    }
+
+    if (!m_Shader)
+        glPopMatrix();
+}
+
+void MeshRenderer::EndDraws()
+{
+    if (m_Restart)
+        glDisable(GL_PRIMITIVE_RESTART);
+
+    if (m_Path == RENDER_PACKED)
+    {
+        gGL.DisableVertexAttribArray(PACKED_ATTRIBUTE);
+        gGL.DisableVertexAttribArray(NORMAL_ATTRIBUTE);
+    }
+
+    if (m_Shader)
+        gGL.UseProgram(0);
+
+    glDisableClientState(GL_NORMAL_ARRAY);
+    glDisableClientState(GL_COLOR_ARRAY);
+    glDisableClientState(GL_VERTEX_ARRAY);
+}
+
+void MeshRenderer::Flush()
+{
+    // The contents are undefined if a buffer was lost while mapped (mode switch and the like): skip the frame.
+    bool valid = gGL.UnmapBuffer(GL_ARRAY_BUFFER) == GL_TRUE;
+    m_Vertices = nullptr;
+
+    if (m_Path != RENDER_STREAM)
+    {
+        valid = (gGL.UnmapBuffer(GL_ELEMENT_ARRAY_BUFFER) == GL_TRUE) && valid;
+        m_Indices = nullptr;
+    }
+
+    if (valid && !m_Draws.empty())
+    {
+        BeginDraws();
+
+        if (m_Path == RENDER_STREAM)
+            SetVertexArrays(0);
+
+        for (const PatchDraw &draw : m_Draws)
+        {
+            if (m_Path != RENDER_STREAM)
+                SetVertexArrays(draw.First);
+
+            DrawMesh(draw, m_StripCounts.data() + draw.FirstStrip, m_StripOffsets.data() + draw.FirstStrip);
+        }
+
+        EndDraws();
+    }
+
+    m_Draws.clear();
+    m_StripCounts.clear();
+    m_StripOffsets.clear();
+}
+
+void MeshRenderer::End()
+{
+    if (!m_Collecting)
+        return;
+
+    m_Collecting = false;
+
+    if (m_Caching)
+        SubmitCached();
+    else
+        Submit();
+
+    m_Caching = false;
+
+    gGL.BindBuffer(GL_ARRAY_BUFFER, 0);
+    gGL.BindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+}
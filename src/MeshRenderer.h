@@ -0,0 +1,190 @@
+//  MeshRenderer.h
+//  Bryan Turner (original version), Rodrigo Verdiani (SDL version)
+//
+//  Parts of the code in this file were borrowed from numerous public sources &
+//  literature.  I reserve NO rights to this code and give a hearty thank-you to all the
+//  excellent sources used in this project.  These include, but are not limited to:
+//
+//  Longbow Digital Arts Programming Forum (www.LongbowDigitalArts.com)
+//  Gamasutra Features (www.Gamasutra.com)
+//  GameDev References (www.GameDev.net)
+//  C. Cookson's ROAM implementation (C.J.Cookson@dcs.warwick.ac.uk OR cjcookson@hotmail.com)
+//  OpenGL Super Bible (Waite Group Press)
+//  And many more...
+
+
+#ifndef MESHRENDERER_H
+#define MESHRENDERER_H
+
+#include <SDL_opengl.h>
+#include <unordered_map>
+#include <vector>
+
+#include "MeshExtractor.h"
+#include "Patch.h"
+
+// Vertices the streaming buffer starts with.  It is orphaned every frame, so keep it small: it grows if a frame needs more.
+#define STREAM_BUFFER_VERTICES 16384
+
+// Same for the index buffer of RENDER_INDEXED & RENDER_STRIPS.
+#define STREAM_BUFFER_INDICES 32768
+
+// Vertex attributes of RENDER_PACKED.  The vertex has to be attribute 0.
+#define PACKED_ATTRIBUTE 0
+#define NORMAL_ATTRIBUTE 1
+
+// Render Paths
+enum RENDER_PATHS
+{
+    RENDER_IMMEDIATE = 0,        // glBegin/glVertex for every leaf triangle (original)
+    RENDER_STREAM,               // Leaf triangles written to a mapped vertex buffer, one draw call per patch
+    RENDER_INDEXED,              // Each vertex of a patch written once, the triangles as 16 bit indices into them
+    RENDER_STRIPS,               // Same vertices, the triangles joined into strips
+    RENDER_DISPLACED,            // Same strips of grid points only: a vertex shader reads heights from a texture
+    RENDER_PACKED                // Same strips of 4 byte vertices, unpacked by a vertex shader
+};
+
+// PatchDraw Struct
+// The vertices (and indices) of one patch in the streaming buffers.
+struct PatchDraw
+{
+    int WorldX, WorldY;
+    int First, Count;
+    int FirstIndex, NumIndices;
+    int FirstStrip, NumStrips;                                    // In the strip arrays of MeshRenderer, for the strip paths
+};
+
+// ShaderProgram Struct
+// The program of one of the vertex shader render paths, and where its uniforms are.
+struct ShaderProgram
+{
+    GLuint Program;                                                // 0 if not loaded
+    bool Failed;                                                // Do not try loading it again
+    GLint OriginLocation, LightingLocation, TexturingLocation;
+
+    ShaderProgram() : Program(0), Failed(false), OriginLocation(-1), LightingLocation(-1), TexturingLocation(-1)
+    {
+    }
+};
+
+// PatchCache Struct
+// The mesh of one patch in buffers of its own, drawn again without being written as long as the patch is tessellated
+// the same way.
+struct PatchCache
+{
+    std::vector<unsigned int> Shape;                            // Patch::Fingerprint() of the mesh
+    int Path, DrawMode;                                            // What it was written for, Path is -1 if out of date
+    int WorldX, WorldY;
+    GLuint VertexBuffer, IndexBuffer;
+    int Count, NumIndices, NumTriangles;
+    std::vector<GLsizei> StripCounts;                            // Strips, for glMultiDrawElements()
+    std::vector<const GLvoid *> StripOffsets;
+
+    PatchCache() : Path(-1), DrawMode(-1), WorldX(0), WorldY(0), VertexBuffer(0), IndexBuffer(0), Count(0), NumIndices(0),
+                   NumTriangles(0)
+    {
+    }
+};
+
+// MeshRenderer Class
+// Draws the patches of a frame from a vertex buffer instead of immediate mode.  The patches are only queued as they
+// come; at the end of the frame the MeshExtractor writes all of them at once on the worker threads, then they are
+// copied to the orphaned and mapped buffer and drawn, one draw call per patch.  The buffer grows to fit the frame.
+// RENDER_DISPLACED keeps a copy of the height map in a texture, uploaded once and patched where it is deformed.
+// With gGeometryCache, each patch is drawn from buffers of its own instead, only written when its mesh changes.
+class MeshRenderer
+{
+protected:
+    GLuint m_Buffer;                                            // Vertex buffer object (0 until the first frame)
+    GLuint m_IndexBuffer;                                        // Index buffer object, for RENDER_INDEXED
+    int m_Path;                                                    // gRenderPath when the frame began
+    int m_Capacity;                                                // Vertices the buffer holds
+    int m_IndexCapacity;                                        // Indices the index buffer holds
+    int m_VertexSize;                                            // Bytes per vertex on m_Path
+    unsigned char *m_Vertices;                                    // The mapped buffer, nullptr outside Begin() & End()
+    GLushort *m_Indices;                                        // The mapped index buffer
+    std::vector<PatchDraw> m_Draws;                                // Patches in the buffers
+
+    bool m_Collecting;                                            // Queuing patches, between Begin() & End()
+    MeshExtractor m_Extractor;
+    std::vector<GLsizei> m_StripCounts;                            // Strips of the frame for glMultiDrawElements(),
+    std::vector<const GLvoid *> m_StripOffsets;                    // when there is no primitive restart
+
+    const unsigned char *m_HeightMap;                            // Height map of the landscapes, for RENDER_DISPLACED
+    GLuint m_HeightTexture;                                        // Its copy on the GPU (0 until first used)
+    int m_DirtyMinX, m_DirtyMinY, m_DirtyMaxX, m_DirtyMaxY;        // Texels out of date (inclusive, empty if min > max)
+    ShaderProgram m_Displacement;                                // Program of RENDER_DISPLACED
+    ShaderProgram m_Packing;                                    // Program of RENDER_PACKED
+    ShaderProgram *m_Shader;                                    // The one of m_Path, nullptr on fixed function paths
+
+    bool m_Caching;                                                // Drawing from m_Cache this frame
+    std::unordered_map<const TriTreeNode *, PatchCache> m_Cache;    // By base triangle, as engines have their own trees
+    std::vector<PatchCache *> m_Entries;                        // Entry of each queued patch
+    int m_CacheHits, m_CacheLookups;                            // Patches of this frame drawn unchanged, and in all
+    bool m_Restart;                                                // Primitive restart on, between BeginDraws() & EndDraws()
+
+    bool Map(int numVertices, int numIndices);
+    void Flush();
+    void SetVertexArrays(int first);
+
+    // The GL stage: draw the extracted patches.
+    void Submit();
+    void SubmitCached();
+
+    // GL state for drawing on m_Path, and the draw call of one patch.
+    void BeginDraws();
+    void DrawMesh(const PatchDraw &draw, const GLsizei *stripCounts, const GLvoid *const *stripOffsets);
+    void EndDraws();
+
+    void WriteCache(PatchCache &cache, PatchMesh &mesh);
+
+    // Get a shader path ready for a frame: its program loaded & the height texture up to date.
+    bool PrepareShader();
+    bool LoadProgram(ShaderProgram &shader, bool displaced);
+    void UploadHeights();
+
+public:
+    MeshRenderer();
+
+    // Between Begin() and End() on one of the buffer paths?
+    bool IsStreaming() const
+    {
+        return m_Collecting;
+    }
+
+    // Patches of the last frame drawn from the cache without being written again, and looked up in it.
+    int GetCacheHits() const
+    {
+        return m_CacheHits;
+    }
+
+    int GetCacheLookups() const
+    {
+        return m_CacheLookups;
+    }
+
+    // The height map RENDER_DISPLACED draws (with its padding rows, see loadTerrain()).
+    void SetHeightMap(const unsigned char *hMap)
+    {
+        m_HeightMap = hMap;
+    }
+
+    // Heights in this rectangle (inclusive) changed: update the texture on the next frame, and forget the cached
+    // meshes over it.
+    void MarkHeightsChanged(int minX, int minY, int maxX, int maxY);
+
+    // Start a frame.  Does nothing unless gRenderPath is a buffer path and the GL has buffer objects.
+    void Begin();
+
+    // Queue a mesh of a patch, to be drawn at End().  Only while IsStreaming().
+    void DrawPatch(Patch *patch, TriTreeNode *baseLeft, TriTreeNode *baseRight);
+
+    // Extract and draw the patches queued since Begin().  The ones that could not be are drawn in immediate mode.
+    void End();
+};
+
+extern int gRenderPath;
+extern int gGeometryCache;
+extern MeshRenderer gRenderer;
+
+#endif
@@ -0,0 +1,186 @@
+//  NormalMap.cpp
+//  Bryan Turner (original version), Rodrigo Verdiani (SDL version)
+//
+//  Parts of the code in this file were borrowed from numerous public sources &
+//  literature.  I reserve NO rights to this code and give a hearty thank-you to all the
+//  excellent sources used in this project.  These include, but are not limited to:
+//
+//  Longbow Digital Arts Programming Forum (www.LongbowDigitalArts.com)
+//  Gamasutra Features (www.Gamasutra.com)
+//  GameDev References (www.GameDev.net)
+//  C. Cookson's ROAM implementation (C.J.Cookson@dcs.warwick.ac.uk OR cjcookson@hotmail.com)
+//  OpenGL Super Bible (Waite Group Press)
+//  And many more...
+
+
+#include <algorithm>
+#include <cmath>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "Landscape.h"
+#include "NormalMap.h"
+#include "ThreadPool.h"
+
+// Rows of the map in one task of Build().
+#define NORMAL_BAND_ROWS 16
+
+#define NORMAL_STRIDE ((MAP_SIZE + 1) * 4)
+
+NormalMap::NormalMap() : m_HeightMap(nullptr), m_Stride(MAP_SIZE + 1)
+{
+}
+
+// The height map sample the mesh reads for grid point (x, y), 0 <= x, y <= MAP_SIZE (the same as UploadHeights()).
+static void GetSource(int x, int y, int &sampleX, int &sampleY)
+{
+    int index = std::min(y * MAP_SIZE + x, MAP_SIZE * (MAP_SIZE + 1) - 1);
+
+    sampleX = index % MAP_SIZE;
+    sampleY = (index / MAP_SIZE) % MAP_SIZE;
+}
+
+// Scalar version of the SIMD loop below, same operations in the same order so the results match to the bit.
+// (The differences are multiples of 0.5, so the squares and their sum are exact too.)
+void NormalMap::BuildSample(int x, int y)
+{
+    int sampleX, sampleY;
+    GetSource(x, y, sampleX, sampleY);
+
+    int left = std::max(sampleX - 1, 0), right = std::min(sampleX + 1, MAP_SIZE - 1);
+    int up = std::max(sampleY - 1, 0), down = std::min(sampleY + 1, MAP_SIZE - 1);
+
+    const unsigned char *row = &m_HeightMap[sampleY * MAP_SIZE];
+
+    float a = (float) (row[left] - row[right]) / (float) (right - left);
+    float b = (float) (m_HeightMap[up * MAP_SIZE + sampleX] - m_HeightMap[down * MAP_SIZE + sampleX]) / (float) (down - up);
+    float scale = 127.0f / sqrtf(a * a + 1.0f + b * b);
+
+    signed char *normal = &m_Normals[y * NORMAL_STRIDE + x * 4];
+    normal[0] = (signed char) lrintf(a * scale);
+    normal[1] = (signed char) lrintf(scale);
+    normal[2] = (signed char) lrintf(b * scale);
+    normal[3] = 0;
+}
+
+void NormalMap::BuildRows(int firstRow, int lastRow, bool simd)
+{
+    for (int y = firstRow; y <= lastRow; y++)
+    {
+        int x = 0;
+
+#ifdef __SSE2__
+        // 16 samples at a time, away from the borders (where the differences are one sided).
+        if (simd && y > 0 && y < MAP_SIZE - 1)
+        {
+            const unsigned char *row = &m_HeightMap[y * MAP_SIZE];
+            signed char *normal = &m_Normals[y * NORMAL_STRIDE];
+            const __m128i zero = _mm_setzero_si128();
+            const __m128 half = _mm_set1_ps(0.5f), one = _mm_set1_ps(1.0f), range = _mm_set1_ps(127.0f);
+
+            BuildSample(x++, y);
+
+            for (; x + 16 <= MAP_SIZE - 1; x += 16)
+            {
+                __m128i left = _mm_loadu_si128((const __m128i *) (row + x - 1));
+                __m128i right = _mm_loadu_si128((const __m128i *) (row + x + 1));
+                __m128i up = _mm_loadu_si128((const __m128i *) (row + x - MAP_SIZE));
+                __m128i down = _mm_loadu_si128((const __m128i *) (row + x + MAP_SIZE));
+
+                // Height differences as 16 bit, 8 samples per register.
+                __m128i dx[2] = {_mm_sub_epi16(_mm_unpacklo_epi8(left, zero), _mm_unpacklo_epi8(right, zero)),
+                                 _mm_sub_epi16(_mm_unpackhi_epi8(left, zero), _mm_unpackhi_epi8(right, zero))};
+                __m128i dz[2] = {_mm_sub_epi16(_mm_unpacklo_epi8(up, zero), _mm_unpacklo_epi8(down, zero)),
+                                 _mm_sub_epi16(_mm_unpackhi_epi8(up, zero), _mm_unpackhi_epi8(down, zero))};
+
+                __m128i packedX[2], packedY[2], packedZ[2];
+                for (int eighth = 0; eighth < 2; eighth++)
+                {
+                    __m128i outX[2], outY[2], outZ[2];
+                    for (int quarter = 0; quarter < 2; quarter++)
+                    {
+                        // Sign extend 4 differences to 32 bit floats.
+                        __m128i wideX = quarter ? _mm_unpackhi_epi16(dx[eighth], dx[eighth]) : _mm_unpacklo_epi16(dx[eighth], dx[eighth]);
+                        __m128i wideZ = quarter ? _mm_unpackhi_epi16(dz[eighth], dz[eighth]) : _mm_unpacklo_epi16(dz[eighth], dz[eighth]);
+                        __m128 a = _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(wideX, 16)), half);
+                        __m128 b = _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(wideZ, 16)), half);
+
+                        __m128 length = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(a, a), one), _mm_mul_ps(b, b)));
+                        __m128 scale = _mm_div_ps(range, length);
+
+                        outX[quarter] = _mm_cvtps_epi32(_mm_mul_ps(a, scale));
+                        outY[quarter] = _mm_cvtps_epi32(scale);
+                        outZ[quarter] = _mm_cvtps_epi32(_mm_mul_ps(b, scale));
+                    }
+
+                    packedX[eighth] = _mm_packs_epi32(outX[0], outX[1]);
+                    packedY[eighth] = _mm_packs_epi32(outY[0], outY[1]);
+                    packedZ[eighth] = _mm_packs_epi32(outZ[0], outZ[1]);
+                }
+
+                __m128i normalX = _mm_packs_epi16(packedX[0], packedX[1]);
+                __m128i normalY = _mm_packs_epi16(packedY[0], packedY[1]);
+                __m128i normalZ = _mm_packs_epi16(packedZ[0], packedZ[1]);
+
+                // Interleave to x, y, z, 0.
+                __m128i xy[2] = {_mm_unpacklo_epi8(normalX, normalY), _mm_unpackhi_epi8(normalX, normalY)};
+                __m128i z0[2] = {_mm_unpacklo_epi8(normalZ, zero), _mm_unpackhi_epi8(normalZ, zero)};
+
+                for (int i = 0; i < 4; i++)
+                {
+                    __m128i xyz = (i & 1) ? _mm_unpackhi_epi16(xy[i >> 1], z0[i >> 1]) : _mm_unpacklo_epi16(xy[i >> 1], z0[i >> 1]);
+                    _mm_storeu_si128((__m128i *) (normal + x * 4 + i * 16), xyz);
+                }
+            }
+        }
+#endif
+
+        for (; x <= MAP_SIZE; x++)
+            BuildSample(x, y);
+    }
+}
+
+void NormalMap::Build(const unsigned char *heightMap, ThreadPool *workers, bool simd)
+{
+    m_HeightMap = heightMap;
+    m_Normals.resize((size_t) (MAP_SIZE + 1) * NORMAL_STRIDE);
+
+    int numBands = (MAP_SIZE + NORMAL_BAND_ROWS) / NORMAL_BAND_ROWS;
+
+    if (!workers || workers->GetNumThreads() == 1)
+        BuildRows(0, MAP_SIZE, simd);
+    else
+        workers->Run(numBands, [this, simd](int band, int)
+        {
+            BuildRows(band * NORMAL_BAND_ROWS, std::min(band * NORMAL_BAND_ROWS + NORMAL_BAND_ROWS - 1, MAP_SIZE), simd);
+        });
+}
+
+void NormalMap::Update(int minX, int minY, int maxX, int maxY)
+{
+    // The samples next to the rectangle see its heights too.
+    minX = std::max(minX - 1, 0);
+    minY = std::max(minY - 1, 0);
+    maxX = std::min(maxX + 1, MAP_SIZE - 1);
+    maxY = std::min(maxY + 1, MAP_SIZE - 1);
+
+    for (int y = minY; y <= maxY; y++)
+        for (int x = minX; x <= maxX; x++)
+            BuildSample(x, y);
+
+    // And so do the samples of the extra row & column that take their heights from them.
+    for (int i = 0; i <= MAP_SIZE; i++)
+    {
+        int sampleX, sampleY;
+
+        GetSource(MAP_SIZE, i, sampleX, sampleY);
+        if (sampleX >= minX && sampleX <= maxX && sampleY >= minY && sampleY <= maxY)
+            BuildSample(MAP_SIZE, i);
+
+        GetSource(i, MAP_SIZE, sampleX, sampleY);
+        if (i < MAP_SIZE && sampleX >= minX && sampleX <= maxX && sampleY >= minY && sampleY <= maxY)
+            BuildSample(i, MAP_SIZE);
+    }
+}
@@ -0,0 +1,78 @@
+//  NormalMap.h
+//  Bryan Turner (original version), Rodrigo Verdiani (SDL version)
+//
+//  Parts of the code in this file were borrowed from numerous public sources &
+//  literature.  I reserve NO rights to this code and give a hearty thank-you to all the
+//  excellent sources used in this project.  These include, but are not limited to:
+//
+//  Longbow Digital Arts Programming Forum (www.LongbowDigitalArts.com)
+//  Gamasutra Features (www.Gamasutra.com)
+//  GameDev References (www.GameDev.net)
+//  C. Cookson's ROAM implementation (C.J.Cookson@dcs.warwick.ac.uk OR cjcookson@hotmail.com)
+//  OpenGL Super Bible (Waite Group Press)
+//  And many more...
+
+
+#ifndef NORMALMAP_H
+#define NORMALMAP_H
+
+#include <cstddef>
+#include <vector>
+
+class ThreadPool;
+
+// NormalMap Class
+// The unit normal of every height map sample, worked out once at load time (and again where the terrain is
+// deformed) instead of for every triangle of every frame.  Central differences of the heights, one sided on the map
+// borders.  Normals are stored as signed 8 bit x, y & z, already unit length so a lookup is three multiplies (an
+// octahedral encoding would take half the memory, but a square root per lookup); the fourth byte pads them to 32 bits.
+// There is one more row & column than the map, for the patch corners on its east & south borders.  Their heights
+// wrap around the map (sample (MAP_SIZE, y) is (0, y + 1) and the extra row is row 0), so they get the normals of the
+// samples they take their heights from.
+class NormalMap
+{
+protected:
+    const unsigned char *m_HeightMap;
+    int m_Stride;                                                // Samples per row, MAP_SIZE + 1
+    std::vector<signed char> m_Normals;                            // x, y, z, 0 for (MAP_SIZE + 1)^2 samples
+
+    void BuildRows(int firstRow, int lastRow, bool simd);
+    void BuildSample(int x, int y);
+
+public:
+    NormalMap();
+
+    // Compute the whole map, split in bands over the workers (nullptr == this thread only).
+    void Build(const unsigned char *heightMap, ThreadPool *workers, bool simd = true);
+
+    // Recompute the normals of a deformed rectangle (inclusive, in samples) and around it.
+    void Update(int minX, int minY, int maxX, int maxY);
+
+    // Unit normal at a sample, 0 <= x, y <= MAP_SIZE.
+    void Get(int x, int y, float normal[3]) const
+    {
+        const signed char *packed = &m_Normals[((size_t) y * m_Stride + x) * 4];
+
+        normal[0] = packed[0] * (1.0f / 127.0f);
+        normal[1] = packed[1] * (1.0f / 127.0f);
+        normal[2] = packed[2] * (1.0f / 127.0f);
+    }
+
+    // The same, as stored: x, y & z times 127, and a zero.
+    const signed char *GetPacked(int x, int y) const
+    {
+        return &m_Normals[((size_t) y * m_Stride + x) * 4];
+    }
+
+    const signed char *GetData() const
+    {
+        return m_Normals.data();
+    }
+
+    size_t GetMemory() const
+    {
+        return m_Normals.size();
+    }
+};
+
+#endif
@@ -15,10 +15,14 @@
 #include <SDL_opengl.h>
 #include <cmath>
 #include <algorithm>
+#include <cstring>
 
 #include "Landscape.h"
+#include "MeshRenderer.h"
+#include "NormalMap.h"
 #include "Patch.h"
 #include "Utility.h"
+#include "VarianceBuilder.h"
 
 // Initialize a patch.
 void Patch::Init(int heightX, int heightY, int worldX, int worldY, unsigned char *hMap)
@@ -39,10 +43,55 @@ void Patch::Init(int heightX, int heightY, int worldX, int worldY, unsigned char
     m_HeightMap = &hMap[heightY * MAP_SIZE + heightX];
 
     // Initialize flags
-    m_VarianceDirty = true;
+    SetDirty();
     m_isVisible = false;
 }
 
+void Patch::SetVarianceTrees(const VarianceTree &left, const VarianceTree &right, bool computed)
+{
+    m_VarianceLeft = left;
+    m_VarianceRight = right;
+
+    if (computed)
+        ClearDirty();
+    else
+        SetDirty();
+}
+
+void Patch::ClearDirty()
+{
+    m_VarianceDirty = false;
+    m_DirtyMinX = m_DirtyMinY = PATCH_SIZE + 1;
+    m_DirtyMaxX = m_DirtyMaxY = -1;
+}
+
+void Patch::SetDirty()
+{
+    m_DirtyMinX = m_DirtyMinY = 0;
+    m_DirtyMaxX = m_DirtyMaxY = PATCH_SIZE;
+    m_VarianceDirty = true;
+}
+
+void Patch::SetDirty(int minX, int minY, int maxX, int maxY)
+{
+    // Grow the rectangle of a patch that is already dirty.
+    if (!m_VarianceDirty)
+    {
+        m_DirtyMinX = minX;
+        m_DirtyMinY = minY;
+        m_DirtyMaxX = maxX;
+        m_DirtyMaxY = maxY;
+    } else
+    {
+        m_DirtyMinX = std::min(m_DirtyMinX, minX);
+        m_DirtyMinY = std::min(m_DirtyMinY, minY);
+        m_DirtyMaxX = std::max(m_DirtyMaxX, maxX);
+        m_DirtyMaxY = std::max(m_DirtyMaxY, maxY);
+    }
+
+    m_VarianceDirty = true;
+}
+
 // Reset the patch.
 void Patch::Reset()
 {
@@ -69,16 +118,23 @@ void Patch::Split(TriTreeNode *tri)
 
     // If this triangle is not in a proper diamond, force split our base neighbor
     if (tri->BaseNeighbor && (tri->BaseNeighbor->BaseNeighbor != tri))
+    {
         Split(tri->BaseNeighbor);
 
+        // Out of nodes.  Splitting only us would leave a crack along the base.
+        if (tri->BaseNeighbor->BaseNeighbor != tri)
+            return;
+    }
+
+    // Make sure the nodes for both halves of the diamond are there before touching the mesh,
+    // so running out of nodes never leaves a half split triangle (or diamond) behind.
+    if (!Landscape::HasRoom((tri->BaseNeighbor && !tri->BaseNeighbor->LeftChild) ? 4 : 2))
+        return;
+
     // Create children and link into mesh
     tri->LeftChild = Landscape::AllocateTri();
     tri->RightChild = Landscape::AllocateTri();
 
-    // If creation failed, just exit.
-    if (!tri->LeftChild || !tri->RightChild)
-        return;
-
     // Fill in the information we can get from the parent (neighbor pointers)
     tri->LeftChild->BaseNeighbor = tri->LeftNeighbor;
     tri->LeftChild->LeftNeighbor = tri->RightChild;
@@ -127,32 +183,124 @@ void Patch::Split(TriTreeNode *tri)
     }
 }
 
+// Projected error of a triangle: its variance scaled down by the distance to the camera.
+float Patch::ComputeTriVariance(float variance, int centerX, int centerY)
+{
+    // Extremely slow distance metric (sqrt is used).
+    // Replace this with a faster one!
+    float distance = 1.0f + sqrtf(((float) centerX - gViewPosition[0]) * ((float) centerX - gViewPosition[0]) +
+            ((float) centerY - gViewPosition[2]) * ((float) centerY - gViewPosition[2]));
+
+    // Egads!  A division too?  What's this world coming to!
+    // This should also be replaced with a faster operation.
+    // Take both distance and variance into consideration
+    return (variance * MAP_SIZE * 2) / distance;
+}
+
+// The split test of ComputeTriVariance() without the sqrt and the division.
+//   variance * MAP_SIZE * 2 / (1 + distance) > gFrameVariance
+//   <=> variance * splitScale - 1 > distance                (splitScale = MAP_SIZE * 2 / gFrameVariance)
+//   <=> limit > 0 && limit * limit > distance * distance    (limit = variance * splitScale - 1)
+// The decisions only differ where rounding puts a node right on the threshold.
+bool Patch::ExceedsFrameVariance(float variance, int centerX, int centerY, float splitScale)
+{
+    float dx = (float) centerX - gViewPosition[0];
+    float dy = (float) centerY - gViewPosition[2];
+    float limit = variance * splitScale - 1.0f;
+
+    return (limit > 0.0f) && (limit * limit > dx * dx + dy * dy);
+}
+
+// Projected error of a triangle in pixels: the variance is a vertical error of variance * MULT_SCALE world units,
+// seen from the camera (height included) through the actual projection.  Errors seen at an angle look smaller,
+// so this is an upper bound.
+float Patch::ComputePixelError(float variance, int centerX, int centerY, float centerZ)
+{
+    float dx = (float) centerX - gViewPosition[0];
+    float dy = (float) centerY - gViewPosition[2];
+    float dz = centerZ * MULT_SCALE - gViewPosition[1];
+    float distance = std::max(NEAR_CLIP, sqrtf(dx * dx + dy * dy + dz * dz));
+
+    float pixelsPerUnit = ((float) gViewportWidth * 0.5f) / tanf(gFovX * 0.5f * (float) M_PI / 180.0f);
+
+    return variance * MULT_SCALE * pixelsPerUnit / distance;
+}
+
+// The split test of ComputePixelError() on squared distances (splitScale = MULT_SCALE * pixelsPerUnit / gPixelTolerance).
+bool Patch::ExceedsPixelTolerance(float variance, int centerX, int centerY, float centerZ, float splitScale)
+{
+    float dx = (float) centerX - gViewPosition[0];
+    float dy = (float) centerY - gViewPosition[2];
+    float dz = centerZ * MULT_SCALE - gViewPosition[1];
+    float limit = variance * splitScale;
+
+    return limit * limit > std::max(NEAR_CLIP * NEAR_CLIP, dx * dx + dy * dy + dz * dz);
+}
+
+// The one division left per frame (infinite when the frame variance is 0: everything is split).
+float Patch::GetSplitScale()
+{
+    if (gErrorMetric == METRIC_SCREEN_SPACE)
+    {
+        float pixelsPerUnit = ((float) gViewportWidth * 0.5f) / tanf(gFovX * 0.5f * (float) M_PI / 180.0f);
+        return MULT_SCALE * pixelsPerUnit / gPixelTolerance;
+    }
+
+    return (float) (MAP_SIZE * 2) / gFrameVariance;
+}
+
+float Patch::GetHeight(int x, int y) const
+{
+    return m_HeightMap[(y - m_WorldY) * MAP_SIZE + (x - m_WorldX)];
+}
+
+bool Patch::IsConforming(const TriTreeNode *tri)
+{
+    if (tri->LeftChild)
+        return IsConforming(tri->LeftChild) && IsConforming(tri->RightChild);
+
+    const TriTreeNode *neighbors[3] = {tri->BaseNeighbor, tri->LeftNeighbor, tri->RightNeighbor};
+    for (const TriTreeNode *neighbor : neighbors)
+    {
+        if (!neighbor)
+            continue;
+
+        // A leaf may only border leaves, and they must point back at it.
+        if (neighbor->LeftChild)
+            return false;
+
+        if (neighbor->BaseNeighbor != tri && neighbor->LeftNeighbor != tri && neighbor->RightNeighbor != tri)
+            return false;
+    }
+
+    return true;
+}
+
 // Tessellate a Patch.
 // Will continue to split until the variance metric is met.
 void Patch::RecursTessellate(TriTreeNode *tri, int leftX, int leftY, int rightX, int rightY, int apexX, int apexY, int node)
 {
-    float TriVariance;
+    // IF we do not have variance info for this node, then we must have gotten here by splitting, so continue down to the lowest level.
+    bool split = true;
 
     // Compute X and Y coordinates of center of Hypotenuse
     int centerX = (leftX + rightX) >> 1;
     int centerY = (leftY + rightY) >> 1;
 
-    if (node < (1 << VARIANCE_DEPTH))
+    // OR if we are not below the variance tree, test for variance.
+    if (m_CurrentVariance->HasNode(node))
     {
-        // Extremely slow distance metric (sqrt is used).
-        // Replace this with a faster one!
-        float distance = 1.0f + sqrtf(((float) centerX - gViewPosition[0]) * ((float) centerX - gViewPosition[0]) +
-                ((float) centerY - gViewPosition[2]) * ((float) centerY - gViewPosition[2]));
-
-        // Egads!  A division too?  What's this world coming to!
-        // This should also be replaced with a faster operation.
-        // Take both distance and variance into consideration
-        TriVariance = ((float) m_CurrentVariance[node] * MAP_SIZE * 2) / distance;
+        float variance = (*m_CurrentVariance)[node];
+
+        if (gErrorMetric == METRIC_SCREEN_SPACE)
+            split = ExceedsPixelTolerance(variance, centerX, centerY, GetHeight(centerX, centerY), m_SplitScale);
+        else if (gErrorMetric == METRIC_SQUARED_DISTANCE)
+            split = ExceedsFrameVariance(variance, centerX, centerY, m_SplitScale);
+        else
+            split = ComputeTriVariance(variance, centerX, centerY) > gFrameVariance;
     }
 
-    // IF we do not have variance info for this node, then we must have gotten here by splitting, so continue down to the lowest level.
-    // OR if we are not below the variance tree, test for variance.
-    if ((node >= (1 << VARIANCE_DEPTH)) || (TriVariance > gFrameVariance))
+    if (split)
     {
         // Split this triangle.
         Split(tri);
@@ -189,30 +337,9 @@ void Patch::RecursRender(TriTreeNode *tri, int leftX, int leftY, int rightX, int
         GLfloat rightZ = m_HeightMap[(rightY * MAP_SIZE) + rightX];
         GLfloat apexZ = m_HeightMap[(apexY * MAP_SIZE) + apexX];
 
-        // Perform lighting calculations if requested.
-        if (gDrawMode == DRAW_USE_LIGHTING)
-        {
-            float v[3][3];
-            float out[3];
-
-            // Create a vertex normal for this triangle.
-            // NOTE: This is an extremely slow operation for illustration purposes only.
-            //       You should use a texture map with the lighting pre-applied to the texture.
-            v[0][0] = (GLfloat) leftX;
-            v[0][1] = (GLfloat) leftZ;
-            v[0][2] = (GLfloat) leftY;
-
-            v[1][0] = (GLfloat) rightX;
-            v[1][1] = (GLfloat) rightZ;
-            v[1][2] = (GLfloat) rightY;
-
-            v[2][0] = (GLfloat) apexX;
-            v[2][1] = (GLfloat) apexZ;
-            v[2][2] = (GLfloat) apexY;
-
-            Utility::CalcNormal(v, out);
-            glNormal3fv(out);
-        }
+        // Smooth lighting with the normals of the height map, worked out at load time.
+        bool lighting = (gDrawMode == DRAW_USE_LIGHTING);
+        float normal[3];
 
         // Perform polygon coloring based on a height sample
         float fColor = (60.0f + leftZ) / 256.0f;
@@ -221,10 +348,16 @@ void Patch::RecursRender(TriTreeNode *tri, int leftX, int leftY, int rightX, int
         glColor3f(fColor, fColor, fColor);
 
         // Output the LEFT VERTEX for the triangle
+        if (lighting)
+        {
+            m_Normals->Get(m_WorldX + leftX, m_WorldY + leftY, normal);
+            glNormal3fv(normal);
+        }
+
         glVertex3f((GLfloat) leftX, (GLfloat) leftZ, (GLfloat) leftY);
 
-        // Gouraud shading based on height samples instead of light normal
-        if (gDrawMode == DRAW_USE_TEXTURE || gDrawMode == DRAW_USE_FILL_ONLY)
+        // Gouraud shading based on height samples (the normals are per vertex too when lighting)
+        if (gDrawMode != DRAW_USE_WIREFRAME)
         {
             fColor = (60.0f + rightZ) / 256.0f;
             if (fColor > 1.0f)
@@ -234,10 +367,16 @@ void Patch::RecursRender(TriTreeNode *tri, int leftX, int leftY, int rightX, int
         }
 
         // Output the RIGHT VERTEX for the triangle
+        if (lighting)
+        {
+            m_Normals->Get(m_WorldX + rightX, m_WorldY + rightY, normal);
+            glNormal3fv(normal);
+        }
+
         glVertex3f((GLfloat) rightX, (GLfloat) rightZ, (GLfloat) rightY);
 
-        // Gouraud shading based on height samples instead of light normal
-        if (gDrawMode == DRAW_USE_TEXTURE || gDrawMode == DRAW_USE_FILL_ONLY)
+        // Gouraud shading based on height samples (the normals are per vertex too when lighting)
+        if (gDrawMode != DRAW_USE_WIREFRAME)
         {
             fColor = (60.0f + apexZ) / 256.0f;
             if (fColor > 1.0f)
@@ -247,13 +386,267 @@ void Patch::RecursRender(TriTreeNode *tri, int leftX, int leftY, int rightX, int
         }
 
         // Output the APEX VERTEX for the triangle
+        if (lighting)
+        {
+            m_Normals->Get(m_WorldX + apexX, m_WorldY + apexY, normal);
+            glNormal3fv(normal);
+        }
+
         glVertex3f((GLfloat) apexX, (GLfloat) apexZ, (GLfloat) apexY);
     }
 }
 
+// Color of a vertex from its height sample, as RecursRender() passes it to glColor3f().
+static GLubyte ShadeColor(GLfloat z)
+{
+    return (GLubyte) (std::min(1.0f, (60.0f + z) / 256.0f) * 255.0f + 0.5f);
+}
+
+// Same walk as RecursRender(), writing the triangles out instead.
+void Patch::RecursExtract(TriTreeNode *tri, int leftX, int leftY, int rightX, int rightY, int apexX, int apexY,
+                          StreamVertex *out, int capacity, int &count)
+{
+    if (tri->LeftChild)
+    {
+        int centerX = (leftX + rightX) >> 1;
+        int centerY = (leftY + rightY) >> 1;
+
+        RecursExtract(tri->LeftChild, apexX, apexY, leftX, leftY, centerX, centerY, out, capacity, count);
+        RecursExtract(tri->RightChild, rightX, rightY, apexX, apexY, centerX, centerY, out, capacity, count);
+        return;
+    }
+
+    count += 3;
+    if (count > capacity)
+        return;
+
+    StreamVertex *vertex = &out[count - 3];
+
+    vertex[0].X = (GLfloat) leftX;
+    vertex[0].Y = m_HeightMap[(leftY * MAP_SIZE) + leftX];
+    vertex[0].Z = (GLfloat) leftY;
+
+    vertex[1].X = (GLfloat) rightX;
+    vertex[1].Y = m_HeightMap[(rightY * MAP_SIZE) + rightX];
+    vertex[1].Z = (GLfloat) rightY;
+
+    vertex[2].X = (GLfloat) apexX;
+    vertex[2].Y = m_HeightMap[(apexY * MAP_SIZE) + apexX];
+    vertex[2].Z = (GLfloat) apexY;
+
+    // Gouraud shading based on height samples, or the color of the left vertex for the whole wireframe triangle.
+    bool gouraud = (gDrawMode != DRAW_USE_WIREFRAME);
+    for (int corner = 0; corner < 3; corner++)
+    {
+        GLubyte shade = ShadeColor(vertex[gouraud ? corner : 0].Y);
+
+        vertex[corner].Color[0] = vertex[corner].Color[1] = vertex[corner].Color[2] = shade;
+        vertex[corner].Color[3] = 255;
+    }
+
+    if (gDrawMode == DRAW_USE_LIGHTING)
+    {
+        m_Normals->Get(m_WorldX + leftX, m_WorldY + leftY, vertex[0].Normal);
+        m_Normals->Get(m_WorldX + rightX, m_WorldY + rightY, vertex[1].Normal);
+        m_Normals->Get(m_WorldX + apexX, m_WorldY + apexY, vertex[2].Normal);
+    }
+}
+
+int Patch::Extract(TriTreeNode *baseLeft, TriTreeNode *baseRight, StreamVertex *out, int capacity)
+{
+    int count = 0;
+
+    RecursExtract(baseLeft, 0, PATCH_SIZE, PATCH_SIZE, 0, 0, 0, out, capacity, count);
+    RecursExtract(baseRight, PATCH_SIZE, 0, 0, PATCH_SIZE, PATCH_SIZE, PATCH_SIZE, out, capacity, count);
+
+    return count;
+}
+
+// Shared vertices can only carry one color, so they get the color of their own height.
+int Patch::IndexedVertex(int x, int y, IndexedMesh &mesh)
+{
+    int key = (y * (PATCH_SIZE + 1)) + x;
+
+    if (mesh.Stamps[key] == mesh.Stamp)
+        return mesh.Slots[key];
+
+    int slot = mesh.NumVertices++;
+    mesh.Stamps[key] = mesh.Stamp;
+    mesh.Slots[key] = slot;
+
+    if (slot >= mesh.VertexCapacity)
+        return slot;
+
+    // The height map stays on the GPU: no heights, colors or normals to look up.
+    if (mesh.Format == VERTEX_GRID)
+    {
+        GridVertex &grid = ((GridVertex *) mesh.Vertices)[slot];
+        grid.X = (GLshort) x;
+        grid.Y = (GLshort) y;
+        return slot;
+    }
+
+    // Bytes are enough within a patch, and the color is the shade of the height.
+    if (mesh.Format == VERTEX_PACKED || mesh.Format == VERTEX_PACKED_LIT)
+    {
+        unsigned char *bytes = (unsigned char *) mesh.Vertices + slot * IndexedMesh::GetVertexSize(mesh.Format);
+        PackedVertex &packed = *(PackedVertex *) bytes;
+        packed.X = (GLubyte) x;
+        packed.Height = m_HeightMap[(y * MAP_SIZE) + x];
+        packed.Y = (GLubyte) y;
+        packed.Shade = ShadeColor(packed.Height);
+
+        if (mesh.Format == VERTEX_PACKED_LIT)
+            memcpy(bytes + sizeof(PackedVertex), m_Normals->GetPacked(m_WorldX + x, m_WorldY + y), 4);
+
+        return slot;
+    }
+
+    StreamVertex &vertex = ((StreamVertex *) mesh.Vertices)[slot];
+    unsigned char *height = &m_HeightMap[(y * MAP_SIZE) + x];
+
+    vertex.X = (GLfloat) x;
+    vertex.Y = *height;
+    vertex.Z = (GLfloat) y;
+
+    vertex.Color[0] = vertex.Color[1] = vertex.Color[2] = ShadeColor(vertex.Y);
+    vertex.Color[3] = 255;
+
+    if (gDrawMode == DRAW_USE_LIGHTING)
+        m_Normals->Get(m_WorldX + x, m_WorldY + y, vertex.Normal);
+
+    return slot;
+}
+
+// The leaves go out in Sierpinski curve order: a triangle is entered at one end of its hypotenuse and left at the
+// other, so each leaf shares an edge with the one before it (the mesh has no T-junctions) and strips run long.
+// Going from left to right, the child holding the left corner comes first and both are walked the other way round.
+void Patch::RecursExtractIndexed(TriTreeNode *tri, int leftX, int leftY, int rightX, int rightY, int apexX, int apexY,
+                                 bool reverse, IndexedMesh &mesh)
+{
+    if (tri->LeftChild)
+    {
+        int centerX = (leftX + rightX) >> 1;
+        int centerY = (leftY + rightY) >> 1;
+
+        if (!reverse)
+            RecursExtractIndexed(tri->LeftChild, apexX, apexY, leftX, leftY, centerX, centerY, true, mesh);
+
+        RecursExtractIndexed(tri->RightChild, rightX, rightY, apexX, apexY, centerX, centerY, !reverse, mesh);
+
+        if (reverse)
+            RecursExtractIndexed(tri->LeftChild, apexX, apexY, leftX, leftY, centerX, centerY, false, mesh);
+        return;
+    }
+
+    int left = IndexedVertex(leftX, leftY, mesh);
+    int right = IndexedVertex(rightX, rightY, mesh);
+    int apex = IndexedVertex(apexX, apexY, mesh);
+
+    mesh.AddTriangle(left, right, apex);
+}
+
+void Patch::ExtractIndexed(TriTreeNode *baseLeft, TriTreeNode *baseRight, IndexedMesh &mesh)
+{
+    RecursExtractIndexed(baseLeft, 0, PATCH_SIZE, PATCH_SIZE, 0, 0, 0, false, mesh);
+    RecursExtractIndexed(baseRight, PATCH_SIZE, 0, 0, PATCH_SIZE, PATCH_SIZE, PATCH_SIZE, false, mesh);
+
+    mesh.EndStrip();
+}
+
+// One bit per node of both trees in preorder, set if the node is split.  This code of a tree is prefix free, so equal
+// shapes mean equal trees, and so equal leaves.
+void Patch::Fingerprint(TriTreeNode *baseLeft, TriTreeNode *baseRight, std::vector<unsigned int> &shape)
+{
+    int bits = 0;
+    shape.clear();
+
+    RecursFingerprint(baseLeft, shape, bits);
+    RecursFingerprint(baseRight, shape, bits);
+}
+
+void Patch::RecursFingerprint(TriTreeNode *tri, std::vector<unsigned int> &shape, int &bits)
+{
+    if ((bits & 31) == 0)
+        shape.push_back(0);
+
+    if (tri->LeftChild)
+        shape.back() |= 1u << (bits & 31);
+
+    bits++;
+
+    if (tri->LeftChild)
+    {
+        RecursFingerprint(tri->LeftChild, shape, bits);
+        RecursFingerprint(tri->RightChild, shape, bits);
+    }
+}
+
+// Gather the leaf edges lying on a patch border.
+// Only triangles with an edge on the border can have descendants with an edge on it, so the walk stays on the border.
+void Patch::RecursCollectBorder(TriTreeNode *tri, int leftX, int leftY, int rightX, int rightY, int apexX, int apexY,
+                                int border, std::vector<BorderEdge> &edges)
+{
+    bool vertical = (border == BORDER_WEST || border == BORDER_EAST);
+    int line = vertical ? m_WorldX : m_WorldY;
+    if (border == BORDER_EAST || border == BORDER_SOUTH)
+        line += PATCH_SIZE;
+
+    bool onLeft = (vertical ? leftX : leftY) == line;
+    bool onRight = (vertical ? rightX : rightY) == line;
+    bool onApex = (vertical ? apexX : apexY) == line;
+
+    // Which edge lies on the border, if any?  (Base: left-right, Left: left-apex, Right: right-apex)
+    TriTreeNode **link;
+    int from, to;
+    if (onLeft && onRight)
+    {
+        link = &tri->BaseNeighbor;
+        from = vertical ? leftY : leftX;
+        to = vertical ? rightY : rightX;
+    } else if (onLeft && onApex)
+    {
+        link = &tri->LeftNeighbor;
+        from = vertical ? leftY : leftX;
+        to = vertical ? apexY : apexX;
+    } else if (onRight && onApex)
+    {
+        link = &tri->RightNeighbor;
+        from = vertical ? rightY : rightX;
+        to = vertical ? apexY : apexX;
+    } else
+        return;
+
+    if (tri->LeftChild)
+    {
+        int centerX = (leftX + rightX) >> 1;
+        int centerY = (leftY + rightY) >> 1;
+
+        RecursCollectBorder(tri->LeftChild, apexX, apexY, leftX, leftY, centerX, centerY, border, edges);
+        RecursCollectBorder(tri->RightChild, rightX, rightY, apexX, apexY, centerX, centerY, border, edges);
+        return;
+    }
+
+    BorderEdge edge;
+    edge.Tri = tri;
+    edge.Link = link;
+    edge.From = std::min(from, to);
+    edge.To = std::max(from, to);
+    edges.push_back(edge);
+}
+
+// Gather the leaf edges on one of the patch borders.
+void Patch::CollectBorder(int border, std::vector<BorderEdge> &edges)
+{
+    RecursCollectBorder(&m_BaseLeft, m_WorldX, m_WorldY + PATCH_SIZE, m_WorldX + PATCH_SIZE, m_WorldY, m_WorldX, m_WorldY,
+                        border, edges);
+    RecursCollectBorder(&m_BaseRight, m_WorldX + PATCH_SIZE, m_WorldY, m_WorldX, m_WorldY + PATCH_SIZE,
+                        m_WorldX + PATCH_SIZE, m_WorldY + PATCH_SIZE, border, edges);
+}
+
 // Computes Variance over the entire tree.  Does not examine node relationships.
-unsigned char Patch::RecursComputeVariance(int leftX, int leftY, unsigned char leftZ, int rightX, int rightY, unsigned char rightZ,
-                                           int apexX, int apexY, unsigned char apexZ, int node)
+int Patch::RecursComputeVariance(int leftX, int leftY, unsigned char leftZ, int rightX, int rightY, unsigned char rightZ,
+                                 int apexX, int apexY, unsigned char apexZ, int node)
 {
     //        /|\
 	//      /  |  \
@@ -270,43 +663,101 @@ unsigned char Patch::RecursComputeVariance(int leftX, int leftY, unsigned char l
 
     // Variance of this triangle is the actual height at its hypotenuse midpoint minus the interpolated height.
     // Use values passed on the stack instead of re-accessing the Height Field.
-    unsigned char myVariance = abs((int) centerZ - (((int) leftZ + (int) rightZ) >> 1));
+    int myVariance = m_CurrentVariance->GetDelta(centerZ, leftZ, rightZ);
 
-    // Since we're after speed and not perfect representations, only calculate variance down to a 8x8 block
-    if ((abs(leftX - rightX) >= 8) || (abs(leftY - rightY) >= 8))
+    // Since we're after speed and not perfect representations, only calculate variance down to the depth of the tree
+    // (8x8 blocks by default)
+    if (m_CurrentVariance->HasChildren(node))
     {
         // Final Variance for this node is the max of its own variance and that of its children.
         myVariance = std::max(myVariance, RecursComputeVariance(apexX, apexY, apexZ, leftX,
-                                                           leftY, leftZ, centerX, centerY,
-                                                           centerZ, node << 1));
+                                                                leftY, leftZ, centerX, centerY,
+                                                                centerZ, node << 1));
         myVariance = std::max(myVariance, RecursComputeVariance(rightX, rightY, rightZ, apexX,
-                                                           apexY, apexZ, centerX, centerY,
-                                                           centerZ, 1 + (node << 1)));
+                                                                apexY, apexZ, centerX, centerY,
+                                                                centerZ, 1 + (node << 1)));
     }
 
-    // Store the final variance for this node.  Note Variance is never zero.
-    if (node < (1 << VARIANCE_DEPTH))
-        m_CurrentVariance[node] = 1 + myVariance;
+    // Store the final variance for this node.
+    m_CurrentVariance->Store(node, myVariance);
+
+    return myVariance;
+}
+
+// Recompute the variance of the nodes whose triangles touch the dirty rectangle.
+// Same as RecursComputeVariance(), except that the stored variance of any other node is still good.
+int Patch::RecursUpdateVariance(int leftX, int leftY, unsigned char leftZ, int rightX, int rightY, unsigned char rightZ,
+                                int apexX, int apexY, unsigned char apexZ, int node)
+{
+    int minX = std::min(std::min(leftX, rightX), apexX);
+    int maxX = std::max(std::max(leftX, rightX), apexX);
+    int minY = std::min(std::min(leftY, rightY), apexY);
+    int maxY = std::max(std::max(leftY, rightY), apexY);
+
+    if (maxX < m_DirtyMinX || minX > m_DirtyMaxX || maxY < m_DirtyMinY || minY > m_DirtyMaxY)
+        return m_CurrentVariance->GetStoredDelta(node);
+
+    int centerX = (leftX + rightX) >> 1;
+    int centerY = (leftY + rightY) >> 1;
+
+    unsigned char centerZ = m_HeightMap[(centerY * MAP_SIZE) + centerX];
+    int myVariance = m_CurrentVariance->GetDelta(centerZ, leftZ, rightZ);
+
+    if (m_CurrentVariance->HasChildren(node))
+    {
+        myVariance = std::max(myVariance, RecursUpdateVariance(apexX, apexY, apexZ, leftX, leftY, leftZ,
+                                                               centerX, centerY, centerZ, node << 1));
+        myVariance = std::max(myVariance, RecursUpdateVariance(rightX, rightY, rightZ, apexX, apexY, apexZ,
+                                                               centerX, centerY, centerZ, 1 + (node << 1)));
+    }
+
+    m_CurrentVariance->Store(node, myVariance);
 
     return myVariance;
 }
 
 // Compute the variance tree for each of the Binary Triangles in this patch.
+// If only part of the patch was deformed, only the nodes whose triangles touch it are recomputed.
 void Patch::ComputeVariance()
+{
+    if (m_DirtyMinX <= 0 && m_DirtyMinY <= 0 && m_DirtyMaxX >= PATCH_SIZE && m_DirtyMaxY >= PATCH_SIZE)
+    {
+        const VarianceBuilder &builder = VarianceBuilder::Get(m_VarianceLeft.Depth);
+
+        builder.Build(m_HeightMap, 0, m_VarianceLeft);
+        builder.Build(m_HeightMap, 1, m_VarianceRight);
+    } else
+    {
+        m_CurrentVariance = &m_VarianceLeft;
+        RecursUpdateVariance(0, PATCH_SIZE, m_HeightMap[PATCH_SIZE * MAP_SIZE], PATCH_SIZE,
+                             0, m_HeightMap[PATCH_SIZE], 0, 0, m_HeightMap[0], 1);
+
+        m_CurrentVariance = &m_VarianceRight;
+        RecursUpdateVariance(PATCH_SIZE, 0, m_HeightMap[PATCH_SIZE], 0, PATCH_SIZE,
+                             m_HeightMap[PATCH_SIZE * MAP_SIZE], PATCH_SIZE, PATCH_SIZE,
+                             m_HeightMap[(PATCH_SIZE * MAP_SIZE) + PATCH_SIZE], 1);
+    }
+
+    // Clear the dirty flag for this patch
+    ClearDirty();
+}
+
+// Same trees as ComputeVariance(), built by the original recursion.
+void Patch::ComputeVarianceRecursive()
 {
     // Compute variance on each of the base triangles...
 
-    m_CurrentVariance = m_VarianceLeft;
+    m_CurrentVariance = &m_VarianceLeft;
     RecursComputeVariance(0, PATCH_SIZE, m_HeightMap[PATCH_SIZE * MAP_SIZE], PATCH_SIZE,
                           0, m_HeightMap[PATCH_SIZE], 0, 0, m_HeightMap[0], 1);
 
-    m_CurrentVariance = m_VarianceRight;
+    m_CurrentVariance = &m_VarianceRight;
     RecursComputeVariance(PATCH_SIZE, 0, m_HeightMap[PATCH_SIZE], 0, PATCH_SIZE,
                           m_HeightMap[PATCH_SIZE * MAP_SIZE], PATCH_SIZE, PATCH_SIZE,
                           m_HeightMap[(PATCH_SIZE * MAP_SIZE) + PATCH_SIZE], 1);
 
     // Clear the dirty flag for this patch
-    m_VarianceDirty = false;
+    ClearDirty();
 }
 
 // Set patch's visibility flag.
@@ -324,12 +775,14 @@ void Patch::SetVisibility(int eyeX, int eyeY, int leftX, int leftY, int rightX,
 // Create an approximate mesh.
 void Patch::Tessellate()
 {
+    m_SplitScale = GetSplitScale();
+
     // Split each of the base triangles
-    m_CurrentVariance = m_VarianceLeft;
+    m_CurrentVariance = &m_VarianceLeft;
     RecursTessellate(&m_BaseLeft, m_WorldX, m_WorldY + PATCH_SIZE, m_WorldX + PATCH_SIZE,
                      m_WorldY, m_WorldX, m_WorldY, 1);
 
-    m_CurrentVariance = m_VarianceRight;
+    m_CurrentVariance = &m_VarianceRight;
     RecursTessellate(&m_BaseRight, m_WorldX + PATCH_SIZE, m_WorldY, m_WorldX,
                      m_WorldY + PATCH_SIZE, m_WorldX + PATCH_SIZE, m_WorldY + PATCH_SIZE, 1);
 }
@@ -337,6 +790,18 @@ void Patch::Tessellate()
 // Render the mesh.
 void Patch::Render()
 {
+    Render(&m_BaseLeft, &m_BaseRight);
+}
+
+// Render a mesh of this patch whose base triangles are kept somewhere else.
+void Patch::Render(TriTreeNode *baseLeft, TriTreeNode *baseRight)
+{
+    if (gRenderer.IsStreaming())
+    {
+        gRenderer.DrawPatch(this, baseLeft, baseRight);
+        return;
+    }
+
     // Store old matrix
     glPushMatrix();
 
@@ -345,8 +810,8 @@ void Patch::Render()
 
     glBegin(GL_TRIANGLES);
 
-    RecursRender(&m_BaseLeft, 0, PATCH_SIZE, PATCH_SIZE, 0, 0, 0);
-    RecursRender(&m_BaseRight, PATCH_SIZE, 0, 0, PATCH_SIZE,
+    RecursRender(baseLeft, 0, PATCH_SIZE, PATCH_SIZE, 0, 0, 0);
+    RecursRender(baseRight, PATCH_SIZE, 0, 0, PATCH_SIZE,
                  PATCH_SIZE, PATCH_SIZE);
 
     glEnd();
@@ -15,11 +15,84 @@
 #ifndef PATCH_H
 #define PATCH_H
 
-// Depth of variance tree: should be near SQRT(PATCH_SIZE) + 1
-#define VARIANCE_DEPTH 9
+#include <cstddef>
+#include <cstdlib>
+#include <vector>
+
+// Variance Formats
+enum VARIANCE_FORMATS
+{
+    VARIANCE_8BIT = 0,            // 1 + midpoint error rounded down, wraps to 0 at 255 (as in the original)
+    VARIANCE_16BIT                // 2 + twice the midpoint error: exact to half a height unit, never wraps
+};
+
+// VarianceTree Struct
+// The variance tree of one base triangle: 1 << Depth entries (node 0 unused) in one of the VARIANCE_FORMATS.
+// Node n holds the largest midpoint error of its triangle and every triangle below it, in the units of the format.
+struct VarianceTree
+{
+    void *Data;
+    int Depth;
+    int Format;
+
+    bool HasNode(int node) const
+    {
+        return node < (1 << Depth);
+    }
+
+    // Can node have children in the tree?
+    bool HasChildren(int node) const
+    {
+        return node < (1 << (Depth - 1));
+    }
+
+    // Midpoint error of a triangle, in the units of the format.
+    int GetDelta(int centerZ, int leftZ, int rightZ) const
+    {
+        if (Format == VARIANCE_16BIT)
+            return abs(2 * centerZ - leftZ - rightZ);
+
+        return abs(centerZ - ((leftZ + rightZ) >> 1));
+    }
+
+    // The delta stored at node (what GetDelta() returned for it).
+    int GetStoredDelta(int node) const
+    {
+        if (Format == VARIANCE_16BIT)
+            return ((const unsigned short *) Data)[node] - 2;
+
+        return (unsigned char) (((const unsigned char *) Data)[node] - 1);
+    }
+
+    // Store a delta.  Note Variance is never zero.
+    void Store(int node, int delta) const
+    {
+        if (Format == VARIANCE_16BIT)
+            ((unsigned short *) Data)[node] = (unsigned short) (2 + delta);
+        else
+            ((unsigned char *) Data)[node] = (unsigned char) (1 + delta);
+    }
+
+    // Variance of a node in height units, as used by the error metrics.
+    float operator[](int node) const
+    {
+        if (Format == VARIANCE_16BIT)
+            return (float) ((const unsigned short *) Data)[node] * 0.5f;
+
+        return (float) ((const unsigned char *) Data)[node];
+    }
+
+    static size_t GetEntrySize(int format)
+    {
+        return (format == VARIANCE_16BIT) ? sizeof(unsigned short) : sizeof(unsigned char);
+    }
+};
 
 // Predefines...
 class Landscape;
+class NormalMap;
+struct StreamVertex;
+struct IndexedMesh;
 
 // TriTreeNode Struct
 // Store the triangle tree data, but no coordinates!
@@ -32,24 +105,47 @@ struct TriTreeNode
     TriTreeNode *RightNeighbor;
 };
 
+// Patch Borders
+enum PATCH_BORDERS
+{
+    BORDER_WEST = 0,                // x == m_WorldX
+    BORDER_EAST,                    // x == m_WorldX + PATCH_SIZE
+    BORDER_NORTH,                    // y == m_WorldY
+    BORDER_SOUTH                    // y == m_WorldY + PATCH_SIZE
+};
+
+// BorderEdge Struct
+// Edge of a leaf triangle lying on a patch border.  Used to stitch patches that were tessellated on their own.
+struct BorderEdge
+{
+    TriTreeNode *Tri;
+    TriTreeNode **Link;                // Neighbor pointer of Tri that crosses the border
+    int From, To;                    // Extent along the border (world coordinates)
+};
+
 // Patch Class
 // Store information needed at the Patch level
 class Patch
 {
 protected:
     unsigned char *m_HeightMap;                                    // Pointer to height map to use
+    const NormalMap *m_Normals;                                    // Normals of the whole height map
     int m_WorldX, m_WorldY;                                        // World coordinate offset of this patch.
 
-    unsigned char m_VarianceLeft[1 << (VARIANCE_DEPTH)];        // Left variance tree
-    unsigned char m_VarianceRight[1 << (VARIANCE_DEPTH)];        // Right variance tree
+    VarianceTree m_VarianceLeft;                                // Left variance tree (storage owned by the Landscape)
+    VarianceTree m_VarianceRight;                                // Right variance tree
 
-    unsigned char *m_CurrentVariance;                            // Which varience we are currently using. [Only valid during the Tessellate and ComputeVariance passes]
+    const VarianceTree *m_CurrentVariance;                        // Which varience we are currently using. [Only valid during the Tessellate and ComputeVariance passes]
+    float m_SplitScale;                                            // GetSplitScale() of this frame. [Only valid during the Tessellate pass]
     bool m_VarianceDirty;                                        // Does the Varience Tree need to be recalculated for this Patch?
+    int m_DirtyMinX, m_DirtyMinY, m_DirtyMaxX, m_DirtyMaxY;        // Height samples changed since then (patch coordinates, inclusive)
     bool m_isVisible;                                            // Is this patch visible in the current frame?
 
     TriTreeNode m_BaseLeft;                                        // Left base triangle tree node
     TriTreeNode m_BaseRight;                                    // Right base triangle tree node
 
+    void ClearDirty();
+
 public:
     // Some encapsulation functions & extras
     TriTreeNode *GetBaseLeft()
@@ -67,13 +163,69 @@ public:
         return m_VarianceDirty;
     }
 
+    // Point the patch at storage for its variance trees.  computed == the trees there are already up to date.
+    void SetVarianceTrees(const VarianceTree &left, const VarianceTree &right, bool computed);
+
+    void SetNormalMap(const NormalMap *normals)
+    {
+        m_Normals = normals;
+    }
+
+    // The height map under this patch changed: recompute its variance tree on the next Landscape::Reset().
+    void SetDirty();
+
+    // Only the height samples in this rectangle changed (patch coordinates, inclusive): just the variance
+    // nodes whose triangles touch it are recomputed.
+    void SetDirty(int minX, int minY, int maxX, int maxY);
+
     bool isVisibile() const
     {
         return m_isVisible;
     }
 
+    int GetWorldX() const
+    {
+        return m_WorldX;
+    }
+
+    int GetWorldY() const
+    {
+        return m_WorldY;
+    }
+
+    const VarianceTree &GetVarianceLeft() const
+    {
+        return m_VarianceLeft;
+    }
+
+    const VarianceTree &GetVarianceRight() const
+    {
+        return m_VarianceRight;
+    }
+
     void SetVisibility(int eyeX, int eyeY, int leftX, int leftY, int rightX, int rightY);
 
+    // Projected error of a triangle with the given variance and hypotenuse center.
+    static float ComputeTriVariance(float variance, int centerX, int centerY);
+
+    // Same as ComputeTriVariance(variance, centerX, centerY) > gFrameVariance, on squared distances.
+    static bool ExceedsFrameVariance(float variance, int centerX, int centerY, float splitScale);
+
+    // Error of a triangle on screen, in pixels.  centerZ is the height at the center of its hypotenuse.
+    static float ComputePixelError(float variance, int centerX, int centerY, float centerZ);
+
+    // Same as ComputePixelError(variance, centerX, centerY, centerZ) > gPixelTolerance, on squared distances.
+    static bool ExceedsPixelTolerance(float variance, int centerX, int centerY, float centerZ, float splitScale);
+
+    // Per-frame constant of ExceedsFrameVariance() or ExceedsPixelTolerance(), depending on gErrorMetric.
+    static float GetSplitScale();
+
+    // True if every leaf under tri only borders leaves that link back to it (no T-junctions, no cracks).
+    static bool IsConforming(const TriTreeNode *tri);
+
+    // Height at world coordinates inside this patch.
+    float GetHeight(int x, int y) const;
+
     // The static half of the Patch Class
     virtual void Init(int heightX, int heightY, int worldX, int worldY, unsigned char *hMap);
 
@@ -83,17 +235,57 @@ public:
 
     virtual void Render();
 
+    virtual void Render(TriTreeNode *baseLeft, TriTreeNode *baseRight);
+
+    // Write the leaf triangles of a mesh of this patch to out (patch coordinates), as Render() would draw them.
+    // Returns the number of vertices; only the first capacity of them are written.
+    virtual int Extract(TriTreeNode *baseLeft, TriTreeNode *baseRight, StreamVertex *out, int capacity);
+
+    // Same, writing each vertex once and the triangles as indices into them (a list or strips, see IndexedMesh).
+    // Shared vertices carry one color, so wireframe triangles are Gouraud shaded here too.
+    virtual void ExtractIndexed(TriTreeNode *baseLeft, TriTreeNode *baseRight, IndexedMesh &mesh);
+
+    // The shape of a mesh of this patch, equal for two meshes exactly when they have the same leaves.
+    virtual void Fingerprint(TriTreeNode *baseLeft, TriTreeNode *baseRight, std::vector<unsigned int> &shape);
+
+    virtual bool IsConforming()
+    {
+        return IsConforming(&m_BaseLeft) && IsConforming(&m_BaseRight);
+    }
+
     virtual void ComputeVariance();
 
+    virtual void ComputeVarianceRecursive();
+
+    // Gather the leaf edges on one of the patch borders (unsorted).
+    virtual void CollectBorder(int border, std::vector<BorderEdge> &edges);
+
     // The recursive half of the Patch Class
     virtual void Split(TriTreeNode *tri);
 
     virtual void RecursTessellate(TriTreeNode *tri, int leftX, int leftY, int rightX, int rightY, int apexX, int apexY, int node);
 
+    virtual void RecursCollectBorder(TriTreeNode *tri, int leftX, int leftY, int rightX, int rightY, int apexX, int apexY,
+                                     int border, std::vector<BorderEdge> &edges);
+
     virtual void RecursRender(TriTreeNode *tri, int leftX, int leftY, int rightX, int rightY, int apexX, int apexY);
 
-    virtual unsigned char RecursComputeVariance(int leftX, int leftY, unsigned char leftZ, int rightX, int rightY, unsigned char rightZ,
-                                                int apexX, int apexY, unsigned char apexZ, int node);
+    virtual void RecursExtract(TriTreeNode *tri, int leftX, int leftY, int rightX, int rightY, int apexX, int apexY,
+                               StreamVertex *out, int capacity, int &count);
+
+    virtual void RecursExtractIndexed(TriTreeNode *tri, int leftX, int leftY, int rightX, int rightY, int apexX, int apexY,
+                                      bool reverse, IndexedMesh &mesh);
+
+    virtual void RecursFingerprint(TriTreeNode *tri, std::vector<unsigned int> &shape, int &bits);
+
+    // Index of the vertex at a grid point of this patch in mesh, writing it out the first time.
+    virtual int IndexedVertex(int x, int y, IndexedMesh &mesh);
+
+    virtual int RecursUpdateVariance(int leftX, int leftY, unsigned char leftZ, int rightX, int rightY, unsigned char rightZ,
+                                     int apexX, int apexY, unsigned char apexZ, int node);
+
+    virtual int RecursComputeVariance(int leftX, int leftY, unsigned char leftZ, int rightX, int rightY, unsigned char rightZ,
+                                      int apexX, int apexY, unsigned char apexZ, int node);
 };
 
 #endif
@@ -0,0 +1,97 @@
+//  PipelinedLandscape.cpp
+//  Bryan Turner (original version), Rodrigo Verdiani (SDL version)
+//
+//  Parts of the code in this file were borrowed from numerous public sources &
+//  literature.  I reserve NO rights to this code and give a hearty thank-you to all the
+//  excellent sources used in this project.  These include, but are not limited to:
+//
+//  Longbow Digital Arts Programming Forum (www.LongbowDigitalArts.com)
+//  Gamasutra Features (www.Gamasutra.com)
+//  GameDev References (www.GameDev.net)
+//  C. Cookson's ROAM implementation (C.J.Cookson@dcs.warwick.ac.uk OR cjcookson@hotmail.com)
+//  OpenGL Super Bible (Waite Group Press)
+//  And many more...
+
+#include "PipelinedLandscape.h"
+
+PipelinedLandscape::PipelinedLandscape(Landscape *front, Landscape *back)
+{
+    m_Buffers[0] = front;
+    m_Buffers[1] = back;
+    m_Front = 0;
+    m_HasFrame = false;
+
+    m_Pending = false;
+    m_Quit = false;
+}
+
+PipelinedLandscape::~PipelinedLandscape()
+{
+    if (!m_Worker.joinable())
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(m_Lock);
+        m_Quit = true;
+    }
+
+    m_Start.notify_one();
+    m_Worker.join();
+}
+
+void PipelinedLandscape::WorkerLoop()
+{
+    for (;;)
+    {
+        {
+            std::unique_lock<std::mutex> lock(m_Lock);
+            m_Start.wait(lock, [this] { return m_Quit || m_Pending; });
+
+            if (m_Quit)
+                return;
+        }
+
+        Landscape *back = GetBack();
+        back->Update();
+
+        {
+            std::lock_guard<std::mutex> lock(m_Lock);
+            m_Pending = false;
+        }
+
+        m_Done.notify_one();
+    }
+}
+
+void PipelinedLandscape::BeginFrame()
+{
+    // Start the worker on first use, so Landscapes that never run pipelined don't pay for a thread.
+    if (!m_Worker.joinable())
+        m_Worker = std::thread(&PipelinedLandscape::WorkerLoop, this);
+
+    // Nothing was tessellated ahead yet: build the front mesh right here.
+    if (!m_HasFrame)
+    {
+        GetFront()->Update();
+        m_HasFrame = true;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_Lock);
+        m_Pending = true;
+    }
+
+    m_Start.notify_one();
+}
+
+void PipelinedLandscape::EndFrame()
+{
+    {
+        std::unique_lock<std::mutex> lock(m_Lock);
+        m_Done.wait(lock, [this] { return !m_Pending; });
+    }
+
+    GetBack()->AdjustFrameVariance();
+
+    m_Front = 1 - m_Front;
+}
@@ -0,0 +1,75 @@
+//  PipelinedLandscape.h
+//  Bryan Turner (original version), Rodrigo Verdiani (SDL version)
+//
+//  Parts of the code in this file were borrowed from numerous public sources &
+//  literature.  I reserve NO rights to this code and give a hearty thank-you to all the
+//  excellent sources used in this project.  These include, but are not limited to:
+//
+//  Longbow Digital Arts Programming Forum (www.LongbowDigitalArts.com)
+//  Gamasutra Features (www.Gamasutra.com)
+//  GameDev References (www.GameDev.net)
+//  C. Cookson's ROAM implementation (C.J.Cookson@dcs.warwick.ac.uk OR cjcookson@hotmail.com)
+//  OpenGL Super Bible (Waite Group Press)
+//  And many more...
+
+#ifndef PIPELINEDLANDSCAPE_H
+#define PIPELINEDLANDSCAPE_H
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include "Landscape.h"
+
+// PipelinedLandscape Class
+// Double buffered per-frame tessellation.  While the front Landscape is drawn, a worker thread
+// rebuilds the back one for the next frame; the two swap at the end of the frame.  The mesh on
+// screen is one frame behind the camera, but tessellation no longer adds to the frame time.
+//
+// The worker reads the camera and frame variance globals, so they must not change between
+// BeginFrame() and EndFrame().  Only draw the front Landscape in between.
+class PipelinedLandscape
+{
+protected:
+    Landscape *m_Buffers[2];                                    // Front & back Landscapes, each with its own node pool
+    int m_Front;                                                // Index of the Landscape to draw
+    bool m_HasFrame;                                            // Has the front Landscape been tessellated yet?
+
+    std::thread m_Worker;
+    std::mutex m_Lock;
+    std::condition_variable m_Start;                            // Signaled when a frame is posted (or on shutdown)
+    std::condition_variable m_Done;                                // Signaled when the back Landscape is ready
+    bool m_Pending;                                                // Back Landscape is being tessellated
+    bool m_Quit;
+
+    void WorkerLoop();
+
+public:
+    PipelinedLandscape(Landscape *front, Landscape *back);
+    ~PipelinedLandscape();
+
+    // Start tessellating the next frame on the worker thread.
+    void BeginFrame();
+
+    // Wait for the worker, adjust the frame variance to the new mesh and swap the buffers.
+    void EndFrame();
+
+    // Throw away the front mesh, so the next BeginFrame() tessellates it for the current camera.
+    // Only call it outside BeginFrame() / EndFrame().
+    void Invalidate()
+    {
+        m_HasFrame = false;
+    }
+
+    Landscape *GetFront()
+    {
+        return m_Buffers[m_Front];
+    }
+
+    Landscape *GetBack()
+    {
+        return m_Buffers[1 - m_Front];
+    }
+};
+
+#endif
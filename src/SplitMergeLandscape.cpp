@@ -0,0 +1,739 @@
+//  SplitMergeLandscape.cpp
+//  Bryan Turner (original version), Rodrigo Verdiani (SDL version)
+//
+//  Parts of the code in this file were borrowed from numerous public sources &
+//  literature.  I reserve NO rights to this code and give a hearty thank-you to all the
+//  excellent sources used in this project.  These include, but are not limited to:
+//
+//  Longbow Digital Arts Programming Forum (www.LongbowDigitalArts.com)
+//  Gamasutra Features (www.Gamasutra.com)
+//  GameDev References (www.GameDev.net)
+//  C. Cookson's ROAM implementation (C.J.Cookson@dcs.warwick.ac.uk OR cjcookson@hotmail.com)
+//  OpenGL Super Bible (Waite Group Press)
+//  And many more...
+
+#include <SDL_opengl.h>
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstdlib>
+
+#include "MeshRenderer.h"
+#include "SplitMergeLandscape.h"
+
+static inline SplitMergeNode *SMNode(TriTreeNode *tri)
+{
+    return static_cast<SplitMergeNode *>(tri);
+}
+
+// Point whichever link of 'tri' referenced oldNode at newNode instead.
+static void ReplaceNeighbor(TriTreeNode *tri, TriTreeNode *oldNode, TriTreeNode *newNode)
+{
+    if (!tri)
+        return;
+
+    if (tri->BaseNeighbor == oldNode)
+        tri->BaseNeighbor = newNode;
+    else if (tri->LeftNeighbor == oldNode)
+        tri->LeftNeighbor = newNode;
+    else if (tri->RightNeighbor == oldNode)
+        tri->RightNeighbor = newNode;
+}
+
+// --------------------------------------
+// SplitMergeQueue
+// --------------------------------------
+
+SplitMergeQueue::SplitMergeQueue(float SplitMergeNode::*key, int SplitMergeNode::*index, bool isMaxHeap)
+{
+    m_Key = key;
+    m_Index = index;
+    m_IsMaxHeap = isMaxHeap;
+}
+
+void SplitMergeQueue::SiftUp(int index)
+{
+    SplitMergeNode *node = m_Heap[index];
+
+    while (index > 0)
+    {
+        int parent = (index - 1) >> 1;
+        if (!IsAbove(node, m_Heap[parent]))
+            break;
+
+        Place(index, m_Heap[parent]);
+        index = parent;
+    }
+
+    Place(index, node);
+}
+
+void SplitMergeQueue::SiftDown(int index)
+{
+    SplitMergeNode *node = m_Heap[index];
+    int size = (int) m_Heap.size();
+
+    for (;;)
+    {
+        int child = 2 * index + 1;
+        if (child >= size)
+            break;
+
+        if (child + 1 < size && IsAbove(m_Heap[child + 1], m_Heap[child]))
+            child++;
+
+        if (!IsAbove(m_Heap[child], node))
+            break;
+
+        Place(index, m_Heap[child]);
+        index = child;
+    }
+
+    Place(index, node);
+}
+
+void SplitMergeQueue::Insert(SplitMergeNode *node)
+{
+    m_Heap.push_back(node);
+    SiftUp((int) m_Heap.size() - 1);
+}
+
+void SplitMergeQueue::Remove(SplitMergeNode *node)
+{
+    int index = node->*m_Index;
+    node->*m_Index = -1;
+
+    SplitMergeNode *last = m_Heap.back();
+    m_Heap.pop_back();
+
+    if (last == node)
+        return;
+
+    // Move the last element into the hole and restore the heap in whichever direction is needed.
+    Place(index, last);
+    SiftUp(index);
+    SiftDown(last->*m_Index);
+}
+
+void SplitMergeQueue::Update(SplitMergeNode *node)
+{
+    int index = node->*m_Index;
+    SiftUp(index);
+    SiftDown(node->*m_Index);
+}
+
+// Restore the heap order after priorities were changed in place (Floyd's method, linear time).
+void SplitMergeQueue::Rebuild()
+{
+    for (int index = (int) m_Heap.size() / 2 - 1; index >= 0; index--)
+        SiftDown(index);
+}
+
+void SplitMergeQueue::Clear()
+{
+    for (SplitMergeNode *node : m_Heap)
+        node->*m_Index = -1;
+
+    m_Heap.clear();
+}
+
+// --------------------------------------
+// SplitMergeLandscape
+// --------------------------------------
+
+SplitMergeLandscape::SplitMergeLandscape(Landscape *land)
+        : m_SplitQueue(&SplitMergeNode::Priority, &SplitMergeNode::SplitIndex, true),
+          m_MergeQueue(&SplitMergeNode::MergePriority, &SplitMergeNode::MergeIndex, false)
+{
+    m_Land = land;
+    m_NextInChunk = POOL_CHUNK_SIZE;
+    m_Batching = false;
+    m_NumNodes = 0;
+    m_NumSplits = m_NumMerges = m_NumRecomputed = 0;
+}
+
+// Get a node from the free list, or from the storage chunks.
+SplitMergeNode *SplitMergeLandscape::AllocateNode()
+{
+    SplitMergeNode *node;
+
+    if (!m_FreeNodes.empty())
+    {
+        node = m_FreeNodes.back();
+        m_FreeNodes.pop_back();
+    } else
+    {
+        if (m_NextInChunk == POOL_CHUNK_SIZE)
+        {
+            m_Chunks.emplace_back(new SplitMergeNode[POOL_CHUNK_SIZE]);
+            m_NextInChunk = 0;
+        }
+
+        node = &(m_Chunks.back()[m_NextInChunk++]);
+    }
+
+    node->LeftChild = node->RightChild = nullptr;
+    node->BaseNeighbor = node->LeftNeighbor = node->RightNeighbor = nullptr;
+    node->Parent = nullptr;
+    node->Priority = node->MergePriority = -1.0f;
+    node->SplitIndex = node->MergeIndex = -1;
+    node->Bucket = -1;
+
+    return node;
+}
+
+void SplitMergeLandscape::FreeNode(SplitMergeNode *node)
+{
+    if (node->SplitIndex >= 0)
+        m_SplitQueue.Remove(node);
+
+    if (node->MergeIndex >= 0)
+        m_MergeQueue.Remove(node);
+
+    RemoveFromBucket(node);
+    m_FreeNodes.push_back(node);
+}
+
+void SplitMergeLandscape::AddToBucket(SplitMergeNode *node, int bucket)
+{
+    if (node->Bucket == bucket)
+        return;
+
+    RemoveFromBucket(node);
+
+    node->Bucket = bucket;
+    node->BucketIndex = (int) m_Buckets[bucket].size();
+    m_Buckets[bucket].push_back(node);
+}
+
+void SplitMergeLandscape::RemoveFromBucket(SplitMergeNode *node)
+{
+    if (node->Bucket < 0)
+        return;
+
+    // Swap the last node of the bucket into our slot.
+    std::vector<SplitMergeNode *> &bucket = m_Buckets[node->Bucket];
+    SplitMergeNode *last = bucket.back();
+    bucket[node->BucketIndex] = last;
+    last->BucketIndex = node->BucketIndex;
+    bucket.pop_back();
+
+    node->Bucket = -1;
+}
+
+// Same size limit as Patch::RecursTessellate: stop once the hypotenuse is down to one height field cell.
+bool SplitMergeLandscape::CanSplit(SplitMergeNode *node)
+{
+    return (abs(node->LeftX - node->RightX) + abs(node->LeftY - node->RightY)) >= 4;
+}
+
+// A split diamond can be merged when all of its children are leaves.
+bool SplitMergeLandscape::IsMergeable(SplitMergeNode *node)
+{
+    if (!node->LeftChild || node->LeftChild->LeftChild || node->RightChild->LeftChild)
+        return false;
+
+    TriTreeNode *base = node->BaseNeighbor;
+    if (base && (!base->LeftChild || base->LeftChild->LeftChild || base->RightChild->LeftChild))
+        return false;
+
+    return true;
+}
+
+// Each diamond is queued once, through the triangle of the pair with the lowest address.
+SplitMergeNode *SplitMergeLandscape::GetDiamond(SplitMergeNode *node)
+{
+    SplitMergeNode *base = SMNode(node->BaseNeighbor);
+    return (!base || node < base) ? node : base;
+}
+
+// Same metric as Patch::RecursTessellate (gErrorMetric).  Also files the node in the bucket matching
+// how soon the camera movement can make this priority stale.
+float SplitMergeLandscape::ComputePriority(SplitMergeNode *node)
+{
+    // Nothing to gain in patches we can't see.  These are recomputed when the patch becomes visible.
+    if (!m_PatchVisible[node->PatchIndex])
+    {
+        RemoveFromBucket(node);
+        return -1.0f;
+    }
+
+    int centerX = (node->LeftX + node->RightX) >> 1;
+    int centerY = (node->LeftY + node->RightY) >> 1;
+
+    // Bucket k holds the nodes with 2^k <= distance * SPLIT_MERGE_TOLERANCE < 2^(k+1) (bucket 0 below 2).
+    // floor(log2(tolerance)) is half the exponent of tolerance^2, so no sqrt is needed.
+    float dx = (float) centerX - gViewPosition[0];
+    float dy = (float) centerY - gViewPosition[2];
+    int exponent;
+    frexpf((dx * dx + dy * dy) * (SPLIT_MERGE_TOLERANCE * SPLIT_MERGE_TOLERANCE), &exponent);
+    int bucket = std::min(std::max((exponent - 1) >> 1, 0), SPLIT_MERGE_BUCKETS - 1);
+
+    AddToBucket(node, bucket);
+
+    // Below the variance tree, use the variance of the deepest ancestor that has one.
+    int varianceNode = node->Node;
+    while (!node->Variance->HasNode(varianceNode))
+        varianceNode >>= 1;
+
+    float variance = (*node->Variance)[varianceNode];
+
+    // A queue needs the error itself rather than a threshold test, so the squared distance metric
+    // ranks by ComputeTriVariance() too: it splits in the same order, only its test is cheaper.
+    float priority;
+    if (gErrorMetric == METRIC_SCREEN_SPACE)
+    {
+        Patch *patch = m_Land->GetPatch(node->PatchIndex % NUM_PATCHES_PER_SIDE, node->PatchIndex / NUM_PATCHES_PER_SIDE);
+        priority = Patch::ComputePixelError(variance, centerX, centerY, patch->GetHeight(centerX, centerY));
+    } else
+        priority = Patch::ComputeTriVariance(variance, centerX, centerY);
+
+    // Keep priorities monotonic (a child never beats its parent), otherwise the queues never settle:
+    // a closer child would always outrank the diamond that was merged to make room for it.
+    if (node->Parent)
+        priority = std::min(priority, node->Parent->Priority);
+
+    return priority;
+}
+
+// A diamond is worth as much as the worse of its two triangles.
+float SplitMergeLandscape::ComputeMergePriority(SplitMergeNode *diamond)
+{
+    SplitMergeNode *base = SMNode(diamond->BaseNeighbor);
+    return base ? std::max(diamond->Priority, base->Priority) : diamond->Priority;
+}
+
+// Recompute a node's priority and fix up the queues it is in (unless the queues are rebuilt afterwards).
+void SplitMergeLandscape::UpdatePriority(SplitMergeNode *node)
+{
+    node->Priority = ComputePriority(node);
+    m_NumRecomputed++;
+
+    if (m_Batching)
+        return;
+
+    if (node->SplitIndex >= 0)
+        m_SplitQueue.Update(node);
+
+    if (node->LeftChild)
+    {
+        SplitMergeNode *diamond = GetDiamond(node);
+        if (diamond->MergeIndex >= 0)
+        {
+            diamond->MergePriority = ComputeMergePriority(diamond);
+            m_MergeQueue.Update(diamond);
+        }
+    }
+}
+
+void SplitMergeLandscape::RecursUpdatePriority(SplitMergeNode *node)
+{
+    UpdatePriority(node);
+
+    if (node->LeftChild)
+    {
+        RecursUpdatePriority(SMNode(node->LeftChild));
+        RecursUpdatePriority(SMNode(node->RightChild));
+    }
+}
+
+// Recompute every priority in a bucket.  The nodes are filed again as they are recomputed.
+void SplitMergeLandscape::RefreshBucket(int bucket)
+{
+    std::vector<SplitMergeNode *> nodes;
+    nodes.swap(m_Buckets[bucket]);
+
+    for (SplitMergeNode *node : nodes)
+        node->Bucket = -1;
+
+    for (SplitMergeNode *node : nodes)
+        UpdatePriority(node);
+
+    m_BucketEyeX[bucket] = gViewPosition[0];
+    m_BucketEyeY[bucket] = gViewPosition[2];
+}
+
+// Queue the diamond 'node' belongs to for merging, if all of its children are leaves.
+void SplitMergeLandscape::AddDiamond(SplitMergeNode *node)
+{
+    if (!IsMergeable(node))
+        return;
+
+    SplitMergeNode *diamond = GetDiamond(node);
+    if (diamond->MergeIndex >= 0)
+        return;
+
+    diamond->MergePriority = ComputeMergePriority(diamond);
+    m_MergeQueue.Insert(diamond);
+}
+
+void SplitMergeLandscape::RemoveDiamond(SplitMergeNode *node)
+{
+    if (!node->LeftChild)
+        return;
+
+    SplitMergeNode *diamond = GetDiamond(node);
+    if (diamond->MergeIndex >= 0)
+        m_MergeQueue.Remove(diamond);
+}
+
+// Will correctly force-split diamonds.  Same algorithm as Patch::Split, plus the queue bookkeeping.
+void SplitMergeLandscape::Split(SplitMergeNode *tri)
+{
+    // We are already split, no need to do it again.
+    if (tri->LeftChild)
+        return;
+
+    // If this triangle is not in a proper diamond, force split our base neighbor
+    if (tri->BaseNeighbor && (tri->BaseNeighbor->BaseNeighbor != tri))
+        Split(SMNode(tri->BaseNeighbor));
+
+    // Create children and fill in their coordinates.
+    SplitMergeNode *left = AllocateNode();
+    SplitMergeNode *right = AllocateNode();
+
+    short centerX = (short) ((tri->LeftX + tri->RightX) >> 1);
+    short centerY = (short) ((tri->LeftY + tri->RightY) >> 1);
+
+    left->Parent = right->Parent = tri;
+    left->PatchIndex = right->PatchIndex = tri->PatchIndex;
+    left->Variance = right->Variance = tri->Variance;
+
+    left->LeftX = tri->ApexX;
+    left->LeftY = tri->ApexY;
+    left->RightX = tri->LeftX;
+    left->RightY = tri->LeftY;
+    left->ApexX = centerX;
+    left->ApexY = centerY;
+    left->Node = tri->Node << 1;
+
+    right->LeftX = tri->RightX;
+    right->LeftY = tri->RightY;
+    right->RightX = tri->ApexX;
+    right->RightY = tri->ApexY;
+    right->ApexX = centerX;
+    right->ApexY = centerY;
+    right->Node = 1 + (tri->Node << 1);
+
+    tri->LeftChild = left;
+    tri->RightChild = right;
+
+    // Fill in the information we can get from the parent (neighbor pointers)
+    left->BaseNeighbor = tri->LeftNeighbor;
+    left->LeftNeighbor = right;
+
+    right->BaseNeighbor = tri->RightNeighbor;
+    right->RightNeighbor = left;
+
+    // Link our Left Neighbor to the new children
+    if (tri->LeftNeighbor)
+    {
+        if (tri->LeftNeighbor->BaseNeighbor == tri)
+            tri->LeftNeighbor->BaseNeighbor = left;
+        else if (tri->LeftNeighbor->LeftNeighbor == tri)
+            tri->LeftNeighbor->LeftNeighbor = left;
+        else if (tri->LeftNeighbor->RightNeighbor == tri)
+            tri->LeftNeighbor->RightNeighbor = left;
+    }
+
+    // Link our Right Neighbor to the new children
+    if (tri->RightNeighbor)
+    {
+        if (tri->RightNeighbor->BaseNeighbor == tri)
+            tri->RightNeighbor->BaseNeighbor = right;
+        else if (tri->RightNeighbor->RightNeighbor == tri)
+            tri->RightNeighbor->RightNeighbor = right;
+        else if (tri->RightNeighbor->LeftNeighbor == tri)
+            tri->RightNeighbor->LeftNeighbor = right;
+    }
+
+    // The triangle is no longer a leaf, and its parent's diamond is no longer mergeable.
+    if (tri->SplitIndex >= 0)
+        m_SplitQueue.Remove(tri);
+
+    if (tri->Parent)
+        RemoveDiamond(tri->Parent);
+
+    m_NumNodes += 2;
+    m_NumSplits++;
+
+    // The children are the new leaves.
+    UpdatePriority(left);
+    UpdatePriority(right);
+
+    if (CanSplit(left))
+        m_SplitQueue.Insert(left);
+    if (CanSplit(right))
+        m_SplitQueue.Insert(right);
+
+    // Link our Base Neighbor to the new children
+    if (tri->BaseNeighbor)
+    {
+        if (tri->BaseNeighbor->LeftChild)
+        {
+            tri->BaseNeighbor->LeftChild->RightNeighbor = right;
+            tri->BaseNeighbor->RightChild->LeftNeighbor = left;
+            left->RightNeighbor = tri->BaseNeighbor->RightChild;
+            right->LeftNeighbor = tri->BaseNeighbor->LeftChild;
+        } else
+            Split(SMNode(tri->BaseNeighbor)); // Base Neighbor (in a diamond with us) was not split yet, so do that now.
+    } else
+    {
+        // An edge triangle, trivial case.
+        left->RightNeighbor = nullptr;
+        right->LeftNeighbor = nullptr;
+    }
+
+    // Both halves of the diamond are split now, so it can be merged back later.
+    AddDiamond(tri);
+}
+
+// Undo the split of a diamond.  All four children must be leaves.
+void SplitMergeLandscape::Merge(SplitMergeNode *diamond)
+{
+    m_MergeQueue.Remove(diamond);
+
+    SplitMergeNode *tris[2] = {diamond, SMNode(diamond->BaseNeighbor)};
+
+    for (SplitMergeNode *tri : tris)
+    {
+        if (!tri)
+            continue;
+
+        TriTreeNode *left = tri->LeftChild;
+        TriTreeNode *right = tri->RightChild;
+
+        // The children's base neighbors are our side neighbors again.
+        tri->LeftNeighbor = left->BaseNeighbor;
+        tri->RightNeighbor = right->BaseNeighbor;
+
+        ReplaceNeighbor(tri->LeftNeighbor, left, tri);
+        ReplaceNeighbor(tri->RightNeighbor, right, tri);
+
+        tri->LeftChild = tri->RightChild = nullptr;
+
+        FreeNode(SMNode(left));
+        FreeNode(SMNode(right));
+        m_NumNodes -= 2;
+
+        m_SplitQueue.Insert(tri);
+    }
+
+    m_NumMerges++;
+
+    // Our parents may have become mergeable.
+    for (SplitMergeNode *tri : tris)
+        if (tri && tri->Parent)
+            AddDiamond(tri->Parent);
+}
+
+// Build the base triangles of every patch and link the whole landscape together.
+void SplitMergeLandscape::Init()
+{
+    m_SplitQueue.Clear();
+    m_MergeQueue.Clear();
+    m_Chunks.clear();
+    m_FreeNodes.clear();
+    m_NextInChunk = POOL_CHUNK_SIZE;
+
+    for (int bucket = 0; bucket < SPLIT_MERGE_BUCKETS; bucket++)
+    {
+        m_Buckets[bucket].clear();
+        m_BucketEyeX[bucket] = gViewPosition[0];
+        m_BucketEyeY[bucket] = gViewPosition[2];
+    }
+
+    for (int y = 0; y < NUM_PATCHES_PER_SIDE; y++)
+    {
+        for (int x = 0; x < NUM_PATCHES_PER_SIDE; x++)
+        {
+            int index = y * NUM_PATCHES_PER_SIDE + x;
+            Patch *patch = m_Land->GetPatch(x, y);
+            short worldX = (short) patch->GetWorldX();
+            short worldY = (short) patch->GetWorldY();
+
+            SplitMergeNode *baseLeft = m_BaseLeft[index] = AllocateNode();
+            SplitMergeNode *baseRight = m_BaseRight[index] = AllocateNode();
+
+            // Same corners as Patch::Tessellate
+            baseLeft->LeftX = worldX;
+            baseLeft->LeftY = (short) (worldY + PATCH_SIZE);
+            baseLeft->RightX = (short) (worldX + PATCH_SIZE);
+            baseLeft->RightY = worldY;
+            baseLeft->ApexX = worldX;
+            baseLeft->ApexY = worldY;
+            baseLeft->Variance = &patch->GetVarianceLeft();
+
+            baseRight->LeftX = (short) (worldX + PATCH_SIZE);
+            baseRight->LeftY = worldY;
+            baseRight->RightX = worldX;
+            baseRight->RightY = (short) (worldY + PATCH_SIZE);
+            baseRight->ApexX = (short) (worldX + PATCH_SIZE);
+            baseRight->ApexY = (short) (worldY + PATCH_SIZE);
+            baseRight->Variance = &patch->GetVarianceRight();
+
+            baseLeft->Node = baseRight->Node = 1;
+            baseLeft->PatchIndex = baseRight->PatchIndex = index;
+
+            // Attach the two base triangles together
+            baseLeft->BaseNeighbor = baseRight;
+            baseRight->BaseNeighbor = baseLeft;
+
+            m_PatchVisible[index] = false;
+        }
+    }
+
+    // Link all the patches together.  The mesh always covers the whole landscape, invisible
+    // patches are simply merged down because of their negative priority.
+    for (int y = 0; y < NUM_PATCHES_PER_SIDE; y++)
+    {
+        for (int x = 0; x < NUM_PATCHES_PER_SIDE; x++)
+        {
+            int index = y * NUM_PATCHES_PER_SIDE + x;
+
+            if (x > 0)
+                m_BaseLeft[index]->LeftNeighbor = m_BaseRight[index - 1];
+
+            if (x < (NUM_PATCHES_PER_SIDE - 1))
+                m_BaseRight[index]->LeftNeighbor = m_BaseLeft[index + 1];
+
+            if (y > 0)
+                m_BaseLeft[index]->RightNeighbor = m_BaseRight[index - NUM_PATCHES_PER_SIDE];
+
+            if (y < (NUM_PATCHES_PER_SIDE - 1))
+                m_BaseRight[index]->RightNeighbor = m_BaseLeft[index + NUM_PATCHES_PER_SIDE];
+
+            m_SplitQueue.Insert(m_BaseLeft[index]);
+            m_SplitQueue.Insert(m_BaseRight[index]);
+        }
+    }
+
+    m_NumNodes = 0;
+}
+
+// Refine last frame's mesh for the current camera.
+void SplitMergeLandscape::Update()
+{
+    m_NumSplits = m_NumMerges = m_NumRecomputed = 0;
+
+    // Reset rendered triangle count.
+    gNumTrisRendered = 0;
+
+    // Catch up with deformed patches.  Their priorities were computed from the old variance trees.
+    m_Land->ComputeVariance(gVarianceBudget);
+
+    for (Patch *patch : m_Land->GetRebuiltPatches())
+    {
+        int index = (patch->GetWorldY() / PATCH_SIZE) * NUM_PATCHES_PER_SIDE + patch->GetWorldX() / PATCH_SIZE;
+        RecursUpdatePriority(m_BaseLeft[index]);
+        RecursUpdatePriority(m_BaseRight[index]);
+    }
+
+    // Patches that came into (or went out of) view need all of their priorities recomputed.
+    m_Land->UpdateVisibility();
+
+    for (int y = 0; y < NUM_PATCHES_PER_SIDE; y++)
+    {
+        for (int x = 0; x < NUM_PATCHES_PER_SIDE; x++)
+        {
+            int index = y * NUM_PATCHES_PER_SIDE + x;
+            bool visible = m_Land->GetPatch(x, y)->isVisibile();
+
+            if (visible == m_PatchVisible[index])
+                continue;
+
+            m_PatchVisible[index] = visible;
+            RecursUpdatePriority(m_BaseLeft[index]);
+            RecursUpdatePriority(m_BaseRight[index]);
+        }
+    }
+
+    // Refresh the buckets whose priorities may be stale by now.  Once the camera moves that is thousands
+    // of nodes, so rebuilding both queues afterwards is cheaper than sifting each node into place.
+    bool refreshed = false;
+    m_Batching = true;
+
+    for (int bucket = 0; bucket < SPLIT_MERGE_BUCKETS; bucket++)
+    {
+        float dx = gViewPosition[0] - m_BucketEyeX[bucket];
+        float dy = gViewPosition[2] - m_BucketEyeY[bucket];
+        float limit = (float) (1 << bucket);
+
+        if (dx * dx + dy * dy >= limit * limit)
+        {
+            RefreshBucket(bucket);
+            refreshed = true;
+        }
+    }
+
+    m_Batching = false;
+
+    if (refreshed)
+    {
+        for (int index = 0; index < m_MergeQueue.Size(); index++)
+        {
+            SplitMergeNode *diamond = m_MergeQueue.Get(index);
+            diamond->MergePriority = ComputeMergePriority(diamond);
+        }
+
+        m_SplitQueue.Rebuild();
+        m_MergeQueue.Rebuild();
+    }
+
+    // Split the worst triangles and merge the best diamonds until the queues are balanced:
+    // as many nodes as desired, and no leaf with more error than the cheapest diamond to merge.
+    // Forced splits can push the count over the limit, and the cheapest merge may then be the
+    // diamond we just split.  Never merge at or above the lowest priority split this frame, or the
+    // two would undo each other forever; the mesh just stays a few nodes over until next frame.
+    bool full = false;
+    float lowestSplit = FLT_MAX;
+    for (int operation = 0; operation < SPLIT_MERGE_MAX_OPERATIONS; operation++)
+    {
+        SplitMergeNode *split = m_SplitQueue.Top();
+        SplitMergeNode *merge = m_MergeQueue.Top();
+
+        if (m_NumNodes > gDesiredTris)
+        {
+            full = true;
+            if (!merge || merge->MergePriority >= lowestSplit)
+                break;
+
+            Merge(merge);
+        } else if (split && split->Priority > 0 && (!full || (merge && split->Priority > merge->MergePriority)))
+        {
+            lowestSplit = std::min(lowestSplit, split->Priority);
+            Split(split);
+        } else
+            break;
+    }
+}
+
+// Render the visible patches.
+void SplitMergeLandscape::Render()
+{
+    // Scale the terrain by the terrain scale specified at compile time.
+    glScalef(1.0f, MULT_SCALE, 1.0f);
+
+    gRenderer.Begin();
+
+    for (int y = 0; y < NUM_PATCHES_PER_SIDE; y++)
+    {
+        for (int x = 0; x < NUM_PATCHES_PER_SIDE; x++)
+        {
+            int index = y * NUM_PATCHES_PER_SIDE + x;
+            if (m_PatchVisible[index])
+                m_Land->GetPatch(x, y)->Render(m_BaseLeft[index], m_BaseRight[index]);
+        }
+    }
+
+    gRenderer.End();
+}
+
+bool SplitMergeLandscape::IsConforming() const
+{
+    for (int index = 0; index < NUM_PATCHES_PER_SIDE * NUM_PATCHES_PER_SIDE; index++)
+        if (!Patch::IsConforming(m_BaseLeft[index]) || !Patch::IsConforming(m_BaseRight[index]))
+            return false;
+
+    return true;
+}
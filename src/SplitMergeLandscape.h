@@ -0,0 +1,200 @@
+//  SplitMergeLandscape.h
+//  Bryan Turner (original version), Rodrigo Verdiani (SDL version)
+//
+//  Parts of the code in this file were borrowed from numerous public sources &
+//  literature.  I reserve NO rights to this code and give a hearty thank-you to all the
+//  excellent sources used in this project.  These include, but are not limited to:
+//
+//  Longbow Digital Arts Programming Forum (www.LongbowDigitalArts.com)
+//  Gamasutra Features (www.Gamasutra.com)
+//  GameDev References (www.GameDev.net)
+//  C. Cookson's ROAM implementation (C.J.Cookson@dcs.warwick.ac.uk OR cjcookson@hotmail.com)
+//  OpenGL Super Bible (Waite Group Press)
+//  And many more...
+
+#ifndef SPLITMERGELANDSCAPE_H
+#define SPLITMERGELANDSCAPE_H
+
+#include <memory>
+#include <vector>
+
+#include "Landscape.h"
+
+// Most splits + merges performed in a single frame.
+#define SPLIT_MERGE_MAX_OPERATIONS 20000
+
+// A priority is recomputed once the camera has moved this fraction of the distance it was computed at.
+#define SPLIT_MERGE_TOLERANCE 0.05f
+
+// Number of priority recomputation buckets.  Bucket k is refreshed every 2^k units of camera movement.
+#define SPLIT_MERGE_BUCKETS 16
+
+// SplitMergeNode Struct
+// A TriTreeNode that survives from frame to frame, so it also needs to know its parent, its
+// coordinates and where it sits in the queues.
+struct SplitMergeNode : public TriTreeNode
+{
+    SplitMergeNode *Parent;
+    short LeftX, LeftY, RightX, RightY, ApexX, ApexY;            // World coordinates of the corners
+    int Node;                                                    // Index in the variance tree (may be below it)
+    int PatchIndex;                                                // Patch this triangle belongs to (y * NUM_PATCHES_PER_SIDE + x)
+    const VarianceTree *Variance;                                // Variance tree of the base triangle this node descends from
+
+    float Priority;                                                // Projected error of this triangle
+    float MergePriority;                                        // Priority of the diamond (only kept on its representative)
+    int SplitIndex;                                                // Position in the split queue, -1 if not queued
+    int MergeIndex;                                                // Position in the merge queue, -1 if not queued
+    int Bucket;                                                    // Recomputation bucket, -1 if none
+    int BucketIndex;                                            // Position in that bucket
+};
+
+// SplitMergeQueue Class
+// Binary heap of nodes that keeps each node's position up to date, so nodes can be removed
+// or re-prioritized in place.
+class SplitMergeQueue
+{
+protected:
+    std::vector<SplitMergeNode *> m_Heap;
+    float SplitMergeNode::*m_Key;                                // Priority member to sort on
+    int SplitMergeNode::*m_Index;                                // Member holding the position in the heap
+    bool m_IsMaxHeap;                                            // Largest priority on top?
+
+    bool IsAbove(SplitMergeNode *a, SplitMergeNode *b) const
+    {
+        return m_IsMaxHeap ? (a->*m_Key > b->*m_Key) : (a->*m_Key < b->*m_Key);
+    }
+
+    void Place(int index, SplitMergeNode *node)
+    {
+        m_Heap[index] = node;
+        node->*m_Index = index;
+    }
+
+    void SiftUp(int index);
+    void SiftDown(int index);
+
+public:
+    SplitMergeQueue(float SplitMergeNode::*key, int SplitMergeNode::*index, bool isMaxHeap);
+
+    void Insert(SplitMergeNode *node);
+    void Remove(SplitMergeNode *node);
+    void Update(SplitMergeNode *node);
+    void Rebuild();
+    void Clear();
+
+    SplitMergeNode *Get(int index) const
+    {
+        return m_Heap[index];
+    }
+
+    SplitMergeNode *Top() const
+    {
+        return m_Heap.empty() ? nullptr : m_Heap[0];
+    }
+
+    int Size() const
+    {
+        return (int) m_Heap.size();
+    }
+};
+
+// SplitMergeLandscape Class
+// Duchaineau's ROAM: the mesh is kept from frame to frame and refined with a split queue
+// (leaves, highest priority first) and a merge queue (mergeable diamonds, lowest priority first).
+// Priorities are only refreshed when the camera moved far enough to change them, so the
+// per-frame cost follows the camera motion instead of the triangle count.
+class SplitMergeLandscape
+{
+protected:
+    Landscape *m_Land;                                            // Landscape providing heights, variance & visibility
+
+    std::vector<std::unique_ptr<SplitMergeNode[]>> m_Chunks;    // Node storage (never moves)
+    int m_NextInChunk;                                            // Next unused node in the last chunk
+    std::vector<SplitMergeNode *> m_FreeNodes;                    // Nodes released by merges
+
+    SplitMergeNode *m_BaseLeft[NUM_PATCHES_PER_SIDE * NUM_PATCHES_PER_SIDE];
+    SplitMergeNode *m_BaseRight[NUM_PATCHES_PER_SIDE * NUM_PATCHES_PER_SIDE];
+    bool m_PatchVisible[NUM_PATCHES_PER_SIDE * NUM_PATCHES_PER_SIDE];
+
+    SplitMergeQueue m_SplitQueue;
+    SplitMergeQueue m_MergeQueue;
+
+    std::vector<SplitMergeNode *> m_Buckets[SPLIT_MERGE_BUCKETS];
+    float m_BucketEyeX[SPLIT_MERGE_BUCKETS];                    // Camera position when each bucket was last refreshed
+    float m_BucketEyeY[SPLIT_MERGE_BUCKETS];
+
+    bool m_Batching;                                            // Priorities change in place, the queues are rebuilt afterwards
+
+    int m_NumNodes;                                                // Nodes created by splits (same meaning as TriPool::GetNumAllocated())
+    int m_NumSplits, m_NumMerges, m_NumRecomputed;                // Statistics for the last frame
+
+    SplitMergeNode *AllocateNode();
+    void FreeNode(SplitMergeNode *node);
+
+    void AddToBucket(SplitMergeNode *node, int bucket);
+    void RemoveFromBucket(SplitMergeNode *node);
+
+    static bool CanSplit(SplitMergeNode *node);
+    static bool IsMergeable(SplitMergeNode *node);
+    static SplitMergeNode *GetDiamond(SplitMergeNode *node);
+
+    float ComputePriority(SplitMergeNode *node);
+    static float ComputeMergePriority(SplitMergeNode *diamond);
+    void UpdatePriority(SplitMergeNode *node);
+    void RecursUpdatePriority(SplitMergeNode *node);
+    void RefreshBucket(int bucket);
+
+    void AddDiamond(SplitMergeNode *node);
+    void RemoveDiamond(SplitMergeNode *node);
+
+    void Split(SplitMergeNode *tri);
+    void Merge(SplitMergeNode *diamond);
+
+public:
+    explicit SplitMergeLandscape(Landscape *land);
+
+    void Init();
+    void Update();
+    void Render();
+
+    int GetNumNodes() const
+    {
+        return m_NumNodes;
+    }
+
+    int GetNumSplits() const
+    {
+        return m_NumSplits;
+    }
+
+    int GetNumMerges() const
+    {
+        return m_NumMerges;
+    }
+
+    int GetNumRecomputed() const
+    {
+        return m_NumRecomputed;
+    }
+
+    // The trees this engine keeps for a patch, and whether it was visible in the last Update().
+    TriTreeNode *GetBaseLeft(int x, int y)
+    {
+        return m_BaseLeft[y * NUM_PATCHES_PER_SIDE + x];
+    }
+
+    TriTreeNode *GetBaseRight(int x, int y)
+    {
+        return m_BaseRight[y * NUM_PATCHES_PER_SIDE + x];
+    }
+
+    bool IsPatchVisible(int x, int y) const
+    {
+        return m_PatchVisible[y * NUM_PATCHES_PER_SIDE + x];
+    }
+
+    // Check that every leaf only borders leaves (no T-junctions).  Debug helper, walks the whole mesh.
+    bool IsConforming() const;
+};
+
+#endif
@@ -0,0 +1,145 @@
+//  ThreadPool.cpp
+//  Bryan Turner (original version), Rodrigo Verdiani (SDL version)
+//
+//  Parts of the code in this file were borrowed from numerous public sources &
+//  literature.  I reserve NO rights to this code and give a hearty thank-you to all the
+//  excellent sources used in this project.  These include, but are not limited to:
+//
+//  Longbow Digital Arts Programming Forum (www.LongbowDigitalArts.com)
+//  Gamasutra Features (www.Gamasutra.com)
+//  GameDev References (www.GameDev.net)
+//  C. Cookson's ROAM implementation (C.J.Cookson@dcs.warwick.ac.uk OR cjcookson@hotmail.com)
+//  OpenGL Super Bible (Waite Group Press)
+//  And many more...
+
+#include <algorithm>
+
+#include "ThreadPool.h"
+
+// Start numThreads - 1 workers (the caller of Run() is the last one).
+ThreadPool::ThreadPool(int numThreads)
+{
+    numThreads = std::max(1, numThreads);
+
+    m_Job = nullptr;
+    m_Generation = 0;
+    m_Active = 0;
+    m_Quit = false;
+
+    for (int i = 0; i < numThreads; i++)
+        m_Queues.emplace_back(new WorkerQueue);
+
+    for (int i = 1; i < numThreads; i++)
+        m_Threads.emplace_back(&ThreadPool::WorkerLoop, this, i);
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_Lock);
+        m_Quit = true;
+    }
+
+    m_Start.notify_all();
+
+    for (std::thread &thread : m_Threads)
+        thread.join();
+}
+
+// Take a task from our own queue, or steal one from another worker.
+bool ThreadPool::GetTask(int worker, int *task)
+{
+    int numQueues = GetNumThreads();
+
+    for (int i = 0; i < numQueues; i++)
+    {
+        WorkerQueue *queue = m_Queues[(worker + i) % numQueues].get();
+        std::lock_guard<std::mutex> lock(queue->Lock);
+
+        if (queue->Tasks.empty())
+            continue;
+
+        // Own queue from the back (most recently queued, still warm), others from the front.
+        if (i == 0)
+        {
+            *task = queue->Tasks.back();
+            queue->Tasks.pop_back();
+        } else
+        {
+            *task = queue->Tasks.front();
+            queue->Tasks.pop_front();
+        }
+
+        return true;
+    }
+
+    return false;
+}
+
+// Run tasks until every queue is empty.  All tasks are queued before the workers wake up,
+// so an empty set of queues means the job is finished as far as this worker is concerned.
+void ThreadPool::RunTasks(int worker)
+{
+    int task;
+    while (GetTask(worker, &task))
+        (*m_Job)(task, worker);
+}
+
+void ThreadPool::WorkerLoop(int worker)
+{
+    int generation = 0;
+
+    for (;;)
+    {
+        {
+            std::unique_lock<std::mutex> lock(m_Lock);
+            m_Start.wait(lock, [&] { return m_Quit || m_Generation != generation; });
+
+            if (m_Quit)
+                return;
+
+            generation = m_Generation;
+        }
+
+        RunTasks(worker);
+
+        {
+            std::lock_guard<std::mutex> lock(m_Lock);
+            m_Active--;
+        }
+
+        m_Done.notify_one();
+    }
+}
+
+void ThreadPool::Run(int numTasks, const std::function<void(int task, int worker)> &job)
+{
+    int numQueues = GetNumThreads();
+
+    // Queue the tasks in contiguous blocks, one block per worker.
+    for (int i = 0; i < numQueues; i++)
+    {
+        WorkerQueue *queue = m_Queues[i].get();
+        std::lock_guard<std::mutex> lock(queue->Lock);
+
+        // Queued back to front, so the owner (popping from the back) starts at the beginning of its block.
+        for (int task = (numTasks * (i + 1)) / numQueues - 1; task >= (numTasks * i) / numQueues; task--)
+            queue->Tasks.push_back(task);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_Lock);
+        m_Job = &job;
+        m_Active = (int) m_Threads.size();
+        m_Generation++;
+    }
+
+    m_Start.notify_all();
+
+    RunTasks(0);
+
+    // Wait for the workers before the job goes out of scope.
+    std::unique_lock<std::mutex> lock(m_Lock);
+    m_Done.wait(lock, [&] { return m_Active == 0; });
+    m_Job = nullptr;
+}
@@ -0,0 +1,68 @@
+//  ThreadPool.h
+//  Bryan Turner (original version), Rodrigo Verdiani (SDL version)
+//
+//  Parts of the code in this file were borrowed from numerous public sources &
+//  literature.  I reserve NO rights to this code and give a hearty thank-you to all the
+//  excellent sources used in this project.  These include, but are not limited to:
+//
+//  Longbow Digital Arts Programming Forum (www.LongbowDigitalArts.com)
+//  Gamasutra Features (www.Gamasutra.com)
+//  GameDev References (www.GameDev.net)
+//  C. Cookson's ROAM implementation (C.J.Cookson@dcs.warwick.ac.uk OR cjcookson@hotmail.com)
+//  OpenGL Super Bible (Waite Group Press)
+//  And many more...
+
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// ThreadPool Class
+// A fixed set of worker threads for fork/join jobs.  Every worker owns a queue of tasks: it takes
+// work from the back of its own queue and, once that is empty, steals from the front of the others.
+// The thread calling Run() works as worker 0, so a pool of one thread runs everything inline.
+class ThreadPool
+{
+protected:
+    struct WorkerQueue
+    {
+        std::mutex Lock;
+        std::deque<int> Tasks;
+    };
+
+    std::vector<std::thread> m_Threads;                            // Workers 1..N-1
+    std::vector<std::unique_ptr<WorkerQueue>> m_Queues;            // One task queue per worker (0 == caller)
+
+    std::mutex m_Lock;                                            // Protects everything below
+    std::condition_variable m_Start;                            // Signaled when a job is posted (or on shutdown)
+    std::condition_variable m_Done;                                // Signaled when a worker ran out of tasks
+    const std::function<void(int, int)> *m_Job;                    // Job of the current Run() call
+    int m_Generation;                                            // Incremented for every job
+    int m_Active;                                                // Workers still busy with the current job
+    bool m_Quit;
+
+    bool GetTask(int worker, int *task);
+    void RunTasks(int worker);
+    void WorkerLoop(int worker);
+
+public:
+    explicit ThreadPool(int numThreads);
+    ~ThreadPool();
+
+    // Call job(task, worker) for every task in [0, numTasks) and wait until all of them are done.
+    // Tasks are handed out in contiguous blocks, so neighboring tasks tend to run on the same worker.
+    void Run(int numTasks, const std::function<void(int task, int worker)> &job);
+
+    int GetNumThreads() const
+    {
+        return (int) m_Queues.size();
+    }
+};
+
+#endif
@@ -0,0 +1,75 @@
+//  TriPool.cpp
+//  Bryan Turner (original version), Rodrigo Verdiani (SDL version)
+//
+//  Parts of the code in this file were borrowed from numerous public sources &
+//  literature.  I reserve NO rights to this code and give a hearty thank-you to all the
+//  excellent sources used in this project.  These include, but are not limited to:
+//
+//  Longbow Digital Arts Programming Forum (www.LongbowDigitalArts.com)
+//  Gamasutra Features (www.Gamasutra.com)
+//  GameDev References (www.GameDev.net)
+//  C. Cookson's ROAM implementation (C.J.Cookson@dcs.warwick.ac.uk OR cjcookson@hotmail.com)
+//  OpenGL Super Bible (Waite Group Press)
+//  And many more...
+
+#include "TriPool.h"
+
+// Create the pool with enough chunks to hold at least initialSize nodes.
+TriPool::TriPool(int initialSize)
+{
+    int numChunks = std::max(1, (initialSize + POOL_CHUNK_SIZE - 1) / POOL_CHUNK_SIZE);
+    for (int i = 0; i < numChunks; i++)
+        m_Chunks.emplace_back(new TriTreeNode[POOL_CHUNK_SIZE]);
+
+    m_CurrentChunk = 0;
+    m_NextInChunk = 0;
+    m_ChunkLimit = POOL_CHUNK_SIZE;
+    m_MaxNodes = 0;
+    m_HighWaterMark = 0;
+}
+
+// Slow path of Allocate(): the current chunk is full (or the node limit was hit).
+// Move on to the next chunk, growing the pool if every chunk is in use.
+TriTreeNode *TriPool::AllocateFromNextChunk()
+{
+    // IF we've hit the node limit, just return NULL (this is handled gracefully)
+    if (m_ChunkLimit < POOL_CHUNK_SIZE)
+        return nullptr;
+
+    if (m_MaxNodes && GetNumAllocated() >= m_MaxNodes)
+        return nullptr;
+
+    m_CurrentChunk++;
+    m_NextInChunk = 0;
+
+    if (m_CurrentChunk == (int) m_Chunks.size())
+        m_Chunks.emplace_back(new TriTreeNode[POOL_CHUNK_SIZE]);
+
+    // Only hand out part of the chunk if the node limit ends inside it.
+    m_ChunkLimit = POOL_CHUNK_SIZE;
+    if (m_MaxNodes)
+        m_ChunkLimit = std::min(m_ChunkLimit, m_MaxNodes - m_CurrentChunk * POOL_CHUNK_SIZE);
+
+    return Allocate();
+}
+
+// Release every node at once.  The chunks are kept for the next frame.
+void TriPool::Reset()
+{
+    m_HighWaterMark = GetHighWaterMark();
+
+    m_CurrentChunk = 0;
+    m_NextInChunk = 0;
+
+    SetMaxNodes(m_MaxNodes);
+}
+
+// Limit the number of nodes handed out per frame (0 == no limit), counting the ones already handed out.
+void TriPool::SetMaxNodes(int maxNodes)
+{
+    m_MaxNodes = std::max(0, maxNodes);
+
+    m_ChunkLimit = POOL_CHUNK_SIZE;
+    if (m_MaxNodes)
+        m_ChunkLimit = std::min(m_ChunkLimit, m_MaxNodes - m_CurrentChunk * POOL_CHUNK_SIZE);
+}
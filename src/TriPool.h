@@ -0,0 +1,88 @@
+//  TriPool.h
+//  Bryan Turner (original version), Rodrigo Verdiani (SDL version)
+//
+//  Parts of the code in this file were borrowed from numerous public sources &
+//  literature.  I reserve NO rights to this code and give a hearty thank-you to all the
+//  excellent sources used in this project.  These include, but are not limited to:
+//
+//  Longbow Digital Arts Programming Forum (www.LongbowDigitalArts.com)
+//  Gamasutra Features (www.Gamasutra.com)
+//  GameDev References (www.GameDev.net)
+//  C. Cookson's ROAM implementation (C.J.Cookson@dcs.warwick.ac.uk OR cjcookson@hotmail.com)
+//  OpenGL Super Bible (Waite Group Press)
+//  And many more...
+
+#ifndef TRIPOOL_H
+#define TRIPOOL_H
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+#include "Patch.h"
+
+// How many TriTreeNodes are allocated at once when the pool has to grow?
+#define POOL_CHUNK_SIZE 4096
+
+// TriPool Class
+// Growable arena of TriTreeNodes.  Nodes are handed out from fixed size chunks which are
+// never moved or freed, so node addresses stay valid until the next Reset().
+class TriPool
+{
+protected:
+    std::vector<std::unique_ptr<TriTreeNode[]>> m_Chunks;        // Chunks allocated so far
+    int m_CurrentChunk;                                            // Chunk we are allocating from
+    int m_NextInChunk;                                            // Index of the next free node in the current chunk
+    int m_ChunkLimit;                                            // Nodes usable in the current chunk (less than a chunk if capped)
+    int m_MaxNodes;                                                // Hard limit on nodes per frame (0 == grow without limit)
+    int m_HighWaterMark;                                        // Most nodes ever used in a single frame
+
+    TriTreeNode *AllocateFromNextChunk();
+
+public:
+    explicit TriPool(int initialSize = POOL_CHUNK_SIZE);
+
+    // Allocate a TriTreeNode, or return nullptr if the node limit was reached.
+    TriTreeNode *Allocate()
+    {
+        if (m_NextInChunk >= m_ChunkLimit)
+            return AllocateFromNextChunk();
+
+        TriTreeNode *pTri = &(m_Chunks[m_CurrentChunk][m_NextInChunk++]);
+        pTri->LeftChild = pTri->RightChild = nullptr;
+
+        return pTri;
+    }
+
+    void Reset();
+
+    void SetMaxNodes(int maxNodes);
+
+    // Can 'count' more nodes be allocated before the node limit?
+    bool HasRoom(int count) const
+    {
+        return !m_MaxNodes || GetNumAllocated() + count <= m_MaxNodes;
+    }
+
+    int GetMaxNodes() const
+    {
+        return m_MaxNodes;
+    }
+
+    int GetNumAllocated() const
+    {
+        return m_CurrentChunk * POOL_CHUNK_SIZE + m_NextInChunk;
+    }
+
+    int GetCapacity() const
+    {
+        return (int) m_Chunks.size() * POOL_CHUNK_SIZE;
+    }
+
+    int GetHighWaterMark() const
+    {
+        return std::max(m_HighWaterMark, GetNumAllocated());
+    }
+};
+
+#endif
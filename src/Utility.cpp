@@ -19,12 +19,18 @@
 #else
 #   include <GL/glu.h>
 #endif
+#include <algorithm>
 #include <cstdio>
 #include <cstdlib>
 #include <iostream>
 
 #include "Utility.h"
 #include "Landscape.h"
+#include "BudgetController.h"
+#include "GLExtensions.h"
+#include "MeshRenderer.h"
+#include "PipelinedLandscape.h"
+#include "SplitMergeLandscape.h"
 
 // Observer and Follower modes
 enum Modes
@@ -35,15 +41,16 @@ enum Modes
     FLY_MODE
 };
 
-// Perspective & Window defines
-#define FOV_ANGLE 90.0f
-#define NEAR_CLIP 1.0f
-#define FAR_CLIP 2500.0f
-
 // --------------------------------------
 // GLOBALS
 // --------------------------------------
 Landscape gLand;
+Landscape gLandBack;
+SplitMergeLandscape gSplitMerge(&gLand);
+PipelinedLandscape gPipeline(&gLand, &gLandBack);
+BudgetController gController;
+GLExtensions gGL;
+MeshRenderer gRenderer;
 
 // Texture
 GLuint gTextureID = 1;
@@ -61,6 +68,13 @@ int gRotating = 0;
 int gDrawFrustum = 1;
 int gCameraMode = OBSERVE_MODE;
 int gDrawMode = DRAW_USE_TEXTURE;
+int gRenderPath = RENDER_STREAM;
+int gGeometryCache = 1;
+int gEngine = ENGINE_PER_FRAME;
+int gTessellateOrder = TESSELLATE_DEPTH_FIRST;
+int gNumThreads = 0;
+int gErrorMetric = METRIC_SQUARED_DISTANCE;
+int gViewportWidth = WINDOW_WIDTH;
 int gStartX = -1, gStartY;
 int gNumTrisRendered;
 std::chrono::time_point<std::chrono::high_resolution_clock> gStartTime, gEndTime;
@@ -72,11 +86,33 @@ float gFovX = 90.0f;
 // Beginning frame variance (should be high, it will adjust automatically)
 float gFrameVariance = 50;
 
+// Largest error allowed on screen, in pixels (METRIC_SCREEN_SPACE only).
+float gPixelTolerance = 4.0f;
+
 // Desired number of Binary Triangle tessellations per frame.
 // This is not the desired number of triangles rendered!
 // There are usually twice as many Binary Triangle structures as there are rendered triangles.
 int gDesiredTris = 10000;
 
+// Hard limit on the TriTreeNodes of a frame for the per-frame engines (0 == the pools grow without limit).
+// Splits past it are skipped, as the original fixed size pool did.
+int gMaxNodes = 0;
+
+// Keep the variance trees in a cache file between runs?
+int gUseVarianceCache = 1;
+
+// Depth of the variance trees (0 == down to 8x8 blocks, like the original) and their VARIANCE_FORMATS.
+int gVarianceDepth = 0;
+int gVarianceFormat = VARIANCE_8BIT;
+
+// Microseconds Landscape::Reset() may spend rebuilding the variance trees of deformed patches each frame (0 == no limit).
+int gVarianceBudget = 1000;
+
+// Microseconds the per-frame engines may spend tessellating a frame (0 == no limit),
+// and the fraction of it the last frame used.
+int gTimeBudget = 0;
+float gBudgetUsage = 0;
+
 // Load the Height Field from a data file
 void loadTerrain(int size, unsigned char **dest)
 {
@@ -175,13 +211,6 @@ void SetDrawModeContext()
 // Initialize the ROAM implementation
 bool roamInit(unsigned char *map)
 {
-    // Perform some bounds checking on the #define statements
-    if (gDesiredTris > POOL_SIZE)
-        return false;
-
-    if (POOL_SIZE < 100)
-        return false;
-
     // TEXTURE INITIALIZATION
     glBindTexture(GL_TEXTURE_2D, gTextureID);
 
@@ -219,6 +248,16 @@ bool roamInit(unsigned char *map)
 
     // Landscape Initialization
     gLand.Init(map);
+    gSplitMerge.Init();
+    gRenderer.SetHeightMap(map);
+
+    if (gLand.IsVarianceCached())
+        std::cout << "Variance trees: mapped from the cache";
+    else
+        std::cout << "Variance trees: " << NUM_PATCHES_PER_SIDE * NUM_PATCHES_PER_SIDE << " patches in " << gLand.GetVarianceTime()
+                  << " ms";
+    std::cout << ", depth " << gLand.GetVarianceDepth() << ", " << (gLand.GetVarianceFormat() == VARIANCE_16BIT ? 16 : 8)
+              << " bit, " << gLand.GetVarianceMemory() / 1024 << " KB" << std::endl;
 
     return true;
 }
@@ -226,10 +265,27 @@ bool roamInit(unsigned char *map)
 // Call all functions needed to draw a frame of the landscape
 void roamDrawFrame()
 {
+    // The split/merge engine refines the mesh it kept from the last frame.
+    if (gEngine == ENGINE_SPLIT_MERGE)
+    {
+        gSplitMerge.Update();
+        gSplitMerge.Render();
+        return;
+    }
+
+    // Draw this frame while the worker tessellates the next one.
+    if (gEngine == ENGINE_PIPELINED)
+    {
+        gPipeline.BeginFrame();
+        gPipeline.GetFront()->Render();
+        gPipeline.EndFrame();
+        return;
+    }
+
     // Perform all the functions needed to render one frame.
-    gLand.Reset();
-    gLand.Tessellate();
+    gLand.Update();
     gLand.Render();
+    gLand.AdjustFrameVariance();
 }
 
 // Draw a simplistic frustum for debug purposes.
@@ -312,6 +368,94 @@ void KeyDrawModeSurf()
     SetDrawModeContext();
 }
 
+void KeyRenderPathToggle()
+{
+    gRenderPath++;
+    if (gRenderPath > RENDER_PACKED)
+        gRenderPath = RENDER_IMMEDIATE;
+
+    const char *names[] = {"immediate mode", "streamed vertex buffer", "indexed vertex buffer", "triangle strips",
+                           "heights displaced on the GPU", "packed 4 byte vertices"};
+    std::cout << "Render path: " << names[gRenderPath] << (gGL.HasBuffers() ? "" : " (no buffer objects, immediate mode)")
+              << std::endl;
+}
+
+void KeyGeometryCacheToggle()
+{
+    gGeometryCache = !gGeometryCache;
+    std::cout << "Geometry cache: " << (gGeometryCache ? "on" : "off") << std::endl;
+}
+
+void KeyEngineToggle()
+{
+    gEngine++;
+    if (gEngine > ENGINE_PIPELINED)
+        gEngine = ENGINE_PER_FRAME;
+
+    if (gEngine == ENGINE_PIPELINED)
+    {
+        // The second landscape of the pipeline costs its own variance trees and normal map, so only
+        // build it once the pipeline is used, as a copy of the first one (craters included).
+        if (!gLandBack.GetHeightMap())
+            gLandBack.Init(gLand);
+
+        // The mesh the pipeline drew last is from before the other engines ran.
+        gPipeline.Invalidate();
+    }
+
+    const char *names[] = {"per-frame rebuild", "split/merge queues", "pipelined per-frame rebuild"};
+    std::cout << "Tessellation engine: " << names[gEngine] << std::endl;
+}
+
+void KeyTessellateOrderToggle()
+{
+    gTessellateOrder++;
+    if (gTessellateOrder > TESSELLATE_PARALLEL)
+        gTessellateOrder = TESSELLATE_DEPTH_FIRST;
+
+    const char *names[] = {"depth first", "priority", "parallel"};
+    std::cout << "Tessellation order: " << names[gTessellateOrder] << std::endl;
+}
+
+void KeyErrorMetricToggle()
+{
+    gErrorMetric++;
+    if (gErrorMetric > METRIC_SCREEN_SPACE)
+        gErrorMetric = METRIC_DISTANCE;
+
+    const char *names[] = {"distance", "squared distance", "screen space"};
+    std::cout << "Error metric: " << names[gErrorMetric] << std::endl;
+}
+
+void KeyControllerToggle()
+{
+    // Report how the outgoing controller did before starting over.
+    gController.PrintStatistics();
+
+    int mode = gController.GetMode() + 1;
+    if (mode > CONTROLLER_BISECTION)
+        mode = CONTROLLER_NUDGE;
+
+    gController.SetMode(mode);
+    gController.ResetStatistics();
+
+    const char *names[] = {"nudge", "PID", "bisection"};
+    std::cout << "Budget controller: " << names[mode] << std::endl;
+}
+
+// Blast a crater into the terrain, a little ahead of the camera.
+void KeyCrater()
+{
+    int x = (int) (gViewPosition[0] + 64.0f * sinf(gClipAngle * M_PI / 180.0f));
+    int y = (int) (gViewPosition[2] - 64.0f * cosf(gClipAngle * M_PI / 180.0f));
+
+    // Both landscapes share the height map: dig it once, then have the pipeline's other landscape
+    // rebuild its variance trees and normals over the crater.
+    gLand.Crater(x, y, CRATER_RADIUS, CRATER_DEPTH);
+    if (gLandBack.GetHeightMap())
+        gLandBack.MarkDeformed(x - CRATER_RADIUS, y - CRATER_RADIUS, x + CRATER_RADIUS, y + CRATER_RADIUS);
+}
+
 void KeyForward()
 {
     switch (gCameraMode)
@@ -426,6 +570,14 @@ void KeyDown()
 
 void KeyMoreDetail()
 {
+    // The screen space metric refines to a pixel tolerance instead of a triangle count.
+    if (gErrorMetric == METRIC_SCREEN_SPACE)
+    {
+        gPixelTolerance = std::max(0.25f, gPixelTolerance * 0.8f);
+        std::cout << "Pixel tolerance: " << gPixelTolerance << std::endl;
+        return;
+    }
+
     gDesiredTris += 500;
     if (gDesiredTris > 20000)
         gDesiredTris = 20000;
@@ -433,6 +585,13 @@ void KeyMoreDetail()
 
 void KeyLessDetail()
 {
+    if (gErrorMetric == METRIC_SCREEN_SPACE)
+    {
+        gPixelTolerance = std::min(64.0f, gPixelTolerance * 1.25f);
+        std::cout << "Pixel tolerance: " << gPixelTolerance << std::endl;
+        return;
+    }
+
     gDesiredTris -= 500;
     if (gDesiredTris < 500)
         gDesiredTris = 500;
@@ -449,6 +608,7 @@ void ChangeSize(GLsizei w, GLsizei h)
 
     // Set the viewport to be the entire window
     glViewport(0, 0, w, h);
+    gViewportWidth = w;
 
     fAspect = (GLfloat) w / (GLfloat) h;
 
@@ -605,6 +765,9 @@ void IdleFunction()
 // the scene.
 void SetupRC()
 {
+    // Entry points of the vertex buffer renderers
+    gGL.Load();
+
     glEnable(GL_DEPTH_TEST); // Hidden surface removal
     glFrontFace(GL_CCW); // Counter clock-wise polygons face out
     glEnable(GL_CULL_FACE); // Cull back-facing triangles
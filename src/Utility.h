@@ -18,6 +18,15 @@
 #define WINDOW_WIDTH 640
 #define WINDOW_HEIGHT 480
 
+// Perspective & Window defines
+#define FOV_ANGLE 90.0f
+#define NEAR_CLIP 1.0f
+#define FAR_CLIP 2500.0f
+
+// Craters of the X key
+#define CRATER_RADIUS 12
+#define CRATER_DEPTH 24
+
 // Globals
 extern std::chrono::time_point<std::chrono::high_resolution_clock> gStartTime, gEndTime;
 extern int gNumFrames;
@@ -36,6 +45,13 @@ extern void drawFrustum();
 
 extern void KeyObserveToggle();
 extern void KeyDrawModeSurf();
+extern void KeyEngineToggle();
+extern void KeyRenderPathToggle();
+extern void KeyGeometryCacheToggle();
+extern void KeyTessellateOrderToggle();
+extern void KeyErrorMetricToggle();
+extern void KeyControllerToggle();
+extern void KeyCrater();
 extern void KeyForward();
 extern void KeyLeft();
 extern void KeyBackward();
@@ -0,0 +1,261 @@
+//  VarianceBuilder.cpp
+//  Bryan Turner (original version), Rodrigo Verdiani (SDL version)
+//
+//  Parts of the code in this file were borrowed from numerous public sources &
+//  literature.  I reserve NO rights to this code and give a hearty thank-you to all the
+//  excellent sources used in this project.  These include, but are not limited to:
+//
+//  Longbow Digital Arts Programming Forum (www.LongbowDigitalArts.com)
+//  Gamasutra Features (www.Gamasutra.com)
+//  GameDev References (www.GameDev.net)
+//  C. Cookson's ROAM implementation (C.J.Cookson@dcs.warwick.ac.uk OR cjcookson@hotmail.com)
+//  OpenGL Super Bible (Waite Group Press)
+//  And many more...
+
+#include <algorithm>
+#include <cstdlib>
+#include <memory>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define VARIANCE_SSE2
+#include <emmintrin.h>
+#endif
+
+#include "Landscape.h"
+#include "VarianceBuilder.h"
+
+// Levels of a bintree whose nodes have children while their hypotenuse spans minSpan or more.
+// All the nodes of a level have the same size, so follow one branch down.
+static int CountLevels(int minSpan)
+{
+    int span = PATCH_SIZE;
+    bool diagonal = true;
+
+    int levels = 1;
+    while (span >= minSpan)
+    {
+        if (!diagonal)
+            span >>= 1;
+
+        diagonal = !diagonal;
+        levels++;
+    }
+
+    return levels;
+}
+
+int VarianceBuilder::GetDefaultDepth()
+{
+    return CountLevels(8);
+}
+
+int VarianceBuilder::GetMaxDepth()
+{
+    // Same cut off as Patch::RecursTessellate()
+    return CountLevels(3);
+}
+
+VarianceBuilder::VarianceBuilder(int depth)
+{
+    m_NumLevels = depth;
+    m_NumNodes = 1 << m_NumLevels;
+
+    for (int base = 0; base < 2; base++)
+    {
+        m_CenterOffset[base].assign(m_NumNodes, 0);
+        m_LeftVertex[base].assign(m_NumNodes, 0);
+        m_RightVertex[base].assign(m_NumNodes, 0);
+    }
+
+    // Corners are vertices m_NumNodes (left), m_NumNodes + 1 (right) and m_NumNodes + 2 (apex).
+    BuildLayout(0, 1, 0, PATCH_SIZE, m_NumNodes, PATCH_SIZE, 0, m_NumNodes + 1, 0, 0, m_NumNodes + 2);
+    BuildLayout(1, 1, PATCH_SIZE, 0, m_NumNodes, 0, PATCH_SIZE, m_NumNodes + 1, PATCH_SIZE, PATCH_SIZE, m_NumNodes + 2);
+
+    m_CornerOffset[0][0] = PATCH_SIZE * MAP_SIZE;
+    m_CornerOffset[0][1] = PATCH_SIZE;
+    m_CornerOffset[0][2] = 0;
+    m_CornerOffset[1][0] = PATCH_SIZE;
+    m_CornerOffset[1][1] = PATCH_SIZE * MAP_SIZE;
+    m_CornerOffset[1][2] = PATCH_SIZE * MAP_SIZE + PATCH_SIZE;
+}
+
+const VarianceBuilder &VarianceBuilder::Get(int depth)
+{
+    // All of them are built on first use: the deepest one only has a few thousand nodes.
+    static const std::vector<std::unique_ptr<VarianceBuilder>> builders = []
+    {
+        std::vector<std::unique_ptr<VarianceBuilder>> all(GetMaxDepth() + 1);
+        for (int level = 1; level <= GetMaxDepth(); level++)
+            all[level].reset(new VarianceBuilder(level));
+
+        return all;
+    }();
+
+    return *builders[depth];
+}
+
+// Walk the bintree the way Patch::RecursComputeVariance() does, recording where every node reads from.
+void VarianceBuilder::BuildLayout(int base, int node, int leftX, int leftY, int leftVertex, int rightX, int rightY,
+                                  int rightVertex, int apexX, int apexY, int apexVertex)
+{
+    int centerX = (leftX + rightX) >> 1;
+    int centerY = (leftY + rightY) >> 1;
+
+    m_CenterOffset[base][node] = centerY * MAP_SIZE + centerX;
+    m_LeftVertex[base][node] = (short) leftVertex;
+    m_RightVertex[base][node] = (short) rightVertex;
+
+    if (node >= (m_NumNodes >> 1))
+        return;
+
+    BuildLayout(base, node << 1, apexX, apexY, apexVertex, leftX, leftY, leftVertex, centerX, centerY, node);
+    BuildLayout(base, 1 + (node << 1), rightX, rightY, rightVertex, apexX, apexY, apexVertex, centerX, centerY, node);
+}
+
+void VarianceBuilder::Build(const unsigned char *heightMap, int base, const VarianceTree &variance) const
+{
+    // Scratch space, one per thread so patches can be built in parallel:
+    // the height of every vertex (the hypotenuse midpoint of each node, then the three corners)
+    // and the heights at both ends of each hypotenuse.
+    static thread_local std::vector<unsigned char> scratch;
+    scratch.resize(m_NumNodes * 3 + 3);
+
+    unsigned char *leftZ = scratch.data();
+    unsigned char *rightZ = leftZ + m_NumNodes;
+    unsigned char *height = rightZ + m_NumNodes;
+
+    const int *centerOffset = m_CenterOffset[base].data();
+    const short *leftVertex = m_LeftVertex[base].data();
+    const short *rightVertex = m_RightVertex[base].data();
+
+    height[0] = 0;
+    for (int node = 1; node < m_NumNodes; node++)
+        height[node] = heightMap[centerOffset[node]];
+
+    for (int corner = 0; corner < 3; corner++)
+        height[m_NumNodes + corner] = heightMap[m_CornerOffset[base][corner]];
+
+    for (int node = 0; node < m_NumNodes; node++)
+    {
+        leftZ[node] = height[leftVertex[node]];
+        rightZ[node] = height[rightVertex[node]];
+    }
+
+    if (variance.Format == VARIANCE_16BIT)
+        Build16(height, leftZ, rightZ, (unsigned short *) variance.Data);
+    else
+        Build8(height, leftZ, rightZ, (unsigned char *) variance.Data);
+}
+
+void VarianceBuilder::Build8(const unsigned char *height, const unsigned char *leftZ, const unsigned char *rightZ,
+                             unsigned char *variance) const
+{
+    static thread_local std::vector<unsigned char> scratch;
+    scratch.resize(m_NumNodes);
+
+    unsigned char *maxVariance = scratch.data();
+
+    // Midpoint delta of every node: |centerZ - ((leftZ + rightZ) >> 1)|
+    int node = 0;
+#ifdef VARIANCE_SSE2
+    const __m128i one = _mm_set1_epi8(1);
+    for (; node + 16 <= m_NumNodes; node += 16)
+    {
+        __m128i left = _mm_loadu_si128((const __m128i *) &leftZ[node]);
+        __m128i right = _mm_loadu_si128((const __m128i *) &rightZ[node]);
+        __m128i center = _mm_loadu_si128((const __m128i *) &height[node]);
+
+        // _mm_avg_epu8 rounds up; take the odd bit back off to round down like the shift.
+        __m128i average = _mm_sub_epi8(_mm_avg_epu8(left, right), _mm_and_si128(_mm_xor_si128(left, right), one));
+        __m128i delta = _mm_or_si128(_mm_subs_epu8(center, average), _mm_subs_epu8(average, center));
+
+        _mm_storeu_si128((__m128i *) &maxVariance[node], delta);
+    }
+#endif
+    for (; node < m_NumNodes; node++)
+        maxVariance[node] = (unsigned char) abs((int) height[node] - (((int) leftZ[node] + (int) rightZ[node]) >> 1));
+
+    // Bottom up: every node above the last level takes the max of its own delta and its two children.
+    for (int first = m_NumNodes >> 2; first >= 1; first >>= 1)
+    {
+        int parent = first;
+#ifdef VARIANCE_SSE2
+        const __m128i lowBytes = _mm_set1_epi16(0x00FF);
+        for (; parent + 16 <= (first << 1); parent += 16)
+        {
+            // Children 2n & 2n+1 are neighbors: max each byte pair, then pack the 16 results together.
+            __m128i childrenLo = _mm_loadu_si128((const __m128i *) &maxVariance[parent << 1]);
+            __m128i childrenHi = _mm_loadu_si128((const __m128i *) &maxVariance[(parent << 1) + 16]);
+
+            childrenLo = _mm_and_si128(_mm_max_epu8(childrenLo, _mm_srli_epi16(childrenLo, 8)), lowBytes);
+            childrenHi = _mm_and_si128(_mm_max_epu8(childrenHi, _mm_srli_epi16(childrenHi, 8)), lowBytes);
+
+            __m128i children = _mm_packus_epi16(childrenLo, childrenHi);
+            __m128i own = _mm_loadu_si128((const __m128i *) &maxVariance[parent]);
+
+            _mm_storeu_si128((__m128i *) &maxVariance[parent], _mm_max_epu8(own, children));
+        }
+#endif
+        for (; parent < (first << 1); parent++)
+            maxVariance[parent] = std::max(maxVariance[parent], std::max(maxVariance[parent << 1], maxVariance[(parent << 1) + 1]));
+    }
+
+    // Store the final variances.  Note Variance is never zero (except where 1 + 255 wraps, as in the recursive version).
+    for (node = 1; node < m_NumNodes; node++)
+        variance[node] = (unsigned char) (1 + maxVariance[node]);
+}
+
+// Same as Build8() with the 16 bit delta |2 * centerZ - leftZ - rightZ|, eight nodes at a time.
+void VarianceBuilder::Build16(const unsigned char *height, const unsigned char *leftZ, const unsigned char *rightZ,
+                              unsigned short *variance) const
+{
+    static thread_local std::vector<unsigned short> scratch;
+    scratch.resize(m_NumNodes);
+
+    unsigned short *maxVariance = scratch.data();
+
+    int node = 0;
+#ifdef VARIANCE_SSE2
+    const __m128i zero = _mm_setzero_si128();
+    for (; node + 8 <= m_NumNodes; node += 8)
+    {
+        __m128i left = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *) &leftZ[node]), zero);
+        __m128i right = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *) &rightZ[node]), zero);
+        __m128i center = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *) &height[node]), zero);
+
+        __m128i delta = _mm_sub_epi16(_mm_add_epi16(center, center), _mm_add_epi16(left, right));
+        delta = _mm_max_epi16(delta, _mm_sub_epi16(zero, delta));
+
+        _mm_storeu_si128((__m128i *) &maxVariance[node], delta);
+    }
+#endif
+    for (; node < m_NumNodes; node++)
+        maxVariance[node] = (unsigned short) abs(2 * (int) height[node] - (int) leftZ[node] - (int) rightZ[node]);
+
+    for (int first = m_NumNodes >> 2; first >= 1; first >>= 1)
+    {
+        int parent = first;
+#ifdef VARIANCE_SSE2
+        const __m128i lowWords = _mm_set1_epi32(0x0000FFFF);
+        for (; parent + 8 <= (first << 1); parent += 8)
+        {
+            // Deltas are at most 510, so the signed max & pack are safe.
+            __m128i childrenLo = _mm_loadu_si128((const __m128i *) &maxVariance[parent << 1]);
+            __m128i childrenHi = _mm_loadu_si128((const __m128i *) &maxVariance[(parent << 1) + 8]);
+
+            childrenLo = _mm_and_si128(_mm_max_epi16(childrenLo, _mm_srli_epi32(childrenLo, 16)), lowWords);
+            childrenHi = _mm_and_si128(_mm_max_epi16(childrenHi, _mm_srli_epi32(childrenHi, 16)), lowWords);
+
+            __m128i children = _mm_packs_epi32(childrenLo, childrenHi);
+            __m128i own = _mm_loadu_si128((const __m128i *) &maxVariance[parent]);
+
+            _mm_storeu_si128((__m128i *) &maxVariance[parent], _mm_max_epi16(own, children));
+        }
+#endif
+        for (; parent < (first << 1); parent++)
+            maxVariance[parent] = std::max(maxVariance[parent], std::max(maxVariance[parent << 1], maxVariance[(parent << 1) + 1]));
+    }
+
+    for (node = 1; node < m_NumNodes; node++)
+        variance[node] = (unsigned short) (2 + maxVariance[node]);
+}
@@ -0,0 +1,61 @@
+//  VarianceBuilder.h
+//  Bryan Turner (original version), Rodrigo Verdiani (SDL version)
+//
+//  Parts of the code in this file were borrowed from numerous public sources &
+//  literature.  I reserve NO rights to this code and give a hearty thank-you to all the
+//  excellent sources used in this project.  These include, but are not limited to:
+//
+//  Longbow Digital Arts Programming Forum (www.LongbowDigitalArts.com)
+//  Gamasutra Features (www.Gamasutra.com)
+//  GameDev References (www.GameDev.net)
+//  C. Cookson's ROAM implementation (C.J.Cookson@dcs.warwick.ac.uk OR cjcookson@hotmail.com)
+//  OpenGL Super Bible (Waite Group Press)
+//  And many more...
+
+#ifndef VARIANCEBUILDER_H
+#define VARIANCEBUILDER_H
+
+#include <vector>
+
+#include "Patch.h"
+
+// VarianceBuilder Class
+// Builds a variance tree level by level instead of recursively.  The geometry of the bintree is the same for
+// every patch, so the height map offset of each node's hypotenuse midpoint and the vertices at the ends of its
+// hypotenuse are worked out once.  A build then reads every midpoint height once, computes the midpoint deltas
+// of all the nodes with SIMD, and max-reduces them level by level from the bottom up.  The result is exactly the
+// tree of Patch::RecursComputeVariance().  There is one builder per tree depth.
+class VarianceBuilder
+{
+protected:
+    int m_NumLevels;                                            // Depth of the trees built
+    int m_NumNodes;                                                // 1 << m_NumLevels (node 0 is unused)
+
+    // Per base triangle (0 == left, 1 == right):
+    std::vector<int> m_CenterOffset[2];                            // Height map offset of the hypotenuse midpoint of each node
+    std::vector<short> m_LeftVertex[2], m_RightVertex[2];        // Ends of the hypotenuse: a node (its midpoint) or a corner
+    int m_CornerOffset[2][3];                                    // Height map offsets of the base triangle's left, right & apex
+
+    void BuildLayout(int base, int node, int leftX, int leftY, int leftVertex, int rightX, int rightY, int rightVertex,
+                     int apexX, int apexY, int apexVertex);
+
+    void Build8(const unsigned char *height, const unsigned char *leftZ, const unsigned char *rightZ, unsigned char *variance) const;
+    void Build16(const unsigned char *height, const unsigned char *leftZ, const unsigned char *rightZ, unsigned short *variance) const;
+
+public:
+    explicit VarianceBuilder(int depth);
+
+    // Shared by all patches.  depth is 1 to GetMaxDepth().
+    static const VarianceBuilder &Get(int depth);
+
+    // Depth of the trees of the original: down to 8x8 blocks.
+    static int GetDefaultDepth();
+
+    // Deepest useful tree: every triangle the tessellation tests has a variance.
+    static int GetMaxDepth();
+
+    // Compute the variance tree of a base triangle (0 == left, 1 == right) of the patch whose height data starts at heightMap.
+    void Build(const unsigned char *heightMap, int base, const VarianceTree &variance) const;
+};
+
+#endif
@@ -0,0 +1,222 @@
+//  VarianceCache.cpp
+//  Bryan Turner (original version), Rodrigo Verdiani (SDL version)
+//
+//  Parts of the code in this file were borrowed from numerous public sources &
+//  literature.  I reserve NO rights to this code and give a hearty thank-you to all the
+//  excellent sources used in this project.  These include, but are not limited to:
+//
+//  Longbow Digital Arts Programming Forum (www.LongbowDigitalArts.com)
+//  Gamasutra Features (www.Gamasutra.com)
+//  GameDev References (www.GameDev.net)
+//  C. Cookson's ROAM implementation (C.J.Cookson@dcs.warwick.ac.uk OR cjcookson@hotmail.com)
+//  OpenGL Super Bible (Waite Group Press)
+//  And many more...
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "Landscape.h"
+#include "VarianceCache.h"
+
+VarianceCache::VarianceCache() : m_Data(nullptr), m_Mapping(nullptr), m_MappingSize(0), m_Depth(0), m_Format(VARIANCE_8BIT)
+{
+}
+
+VarianceCache::~VarianceCache()
+{
+    Release();
+}
+
+size_t VarianceCache::GetTreeSize() const
+{
+    return ((size_t) 1 << m_Depth) * VarianceTree::GetEntrySize(m_Format);
+}
+
+size_t VarianceCache::GetDataSize() const
+{
+    return (size_t) NUM_PATCHES_PER_SIDE * NUM_PATCHES_PER_SIDE * 2 * GetTreeSize();
+}
+
+VarianceTree VarianceCache::GetVarianceLeft(int patchIndex)
+{
+    VarianceTree tree;
+    tree.Data = m_Data + (size_t) patchIndex * 2 * GetTreeSize();
+    tree.Depth = m_Depth;
+    tree.Format = m_Format;
+
+    return tree;
+}
+
+VarianceTree VarianceCache::GetVarianceRight(int patchIndex)
+{
+    VarianceTree tree = GetVarianceLeft(patchIndex);
+    tree.Data = (unsigned char *) tree.Data + GetTreeSize();
+
+    return tree;
+}
+
+// FNV-1a, eight bytes at a time.
+uint64_t VarianceCache::HashHeightMap(const unsigned char *hMap)
+{
+    uint64_t hash = 14695981039346656037ULL;
+
+    for (size_t offset = 0; offset < (size_t) MAP_SIZE * MAP_SIZE; offset += sizeof(uint64_t))
+    {
+        uint64_t word;
+        memcpy(&word, hMap + offset, sizeof(word));
+
+        hash ^= word;
+        hash *= 1099511628211ULL;
+    }
+
+    return hash;
+}
+
+static void FillHeader(VarianceCacheHeader *header, uint64_t heightMapHash, int depth, int format)
+{
+    memset(header, 0, sizeof(*header));
+    memcpy(header->Magic, "RVAR", 4);
+    header->Version = VARIANCE_CACHE_VERSION;
+    header->MapSize = MAP_SIZE;
+    header->PatchSize = PATCH_SIZE;
+    header->VarianceDepth = depth;
+    header->VarianceFormat = format;
+    header->HeightMapHash = heightMapHash;
+}
+
+bool VarianceCache::Load(uint64_t heightMapHash, int depth, int format)
+{
+    Release();
+
+    m_Depth = depth;
+    m_Format = format;
+
+    char fileName[64];
+    snprintf(fileName, sizeof(fileName), VARIANCE_CACHE_FILE, MAP_SIZE);
+
+    size_t size = sizeof(VarianceCacheHeader) + GetDataSize();
+
+#ifdef _WIN32
+    // No mmap() here: read the file into memory instead.
+    FILE *fp = fopen(fileName, "rb");
+    if (!fp)
+        return false;
+
+    void *mapping = malloc(size);
+    bool ok = mapping && fread(mapping, 1, size, fp) == size && fgetc(fp) == EOF;
+    fclose(fp);
+
+    if (!ok)
+    {
+        free(mapping);
+        return false;
+    }
+#else
+    int fd = open(fileName, O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || (size_t) info.st_size != size)
+    {
+        close(fd);
+        return false;
+    }
+
+    void *mapping = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if (mapping == MAP_FAILED)
+        return false;
+#endif
+
+    m_Mapping = mapping;
+    m_MappingSize = size;
+
+    VarianceCacheHeader expected;
+    FillHeader(&expected, heightMapHash, m_Depth, m_Format);
+
+    if (memcmp(m_Mapping, &expected, sizeof(expected)) != 0)
+    {
+        // Stale: built for another map or another build of the program.
+        Release();
+        return false;
+    }
+
+    m_Data = (unsigned char *) m_Mapping + sizeof(VarianceCacheHeader);
+    return true;
+}
+
+void VarianceCache::Allocate(int depth, int format)
+{
+    Release();
+
+    m_Depth = depth;
+    m_Format = format;
+
+    m_Data = (unsigned char *) calloc(GetDataSize(), 1);
+}
+
+void VarianceCache::Copy(const VarianceCache &source)
+{
+    Allocate(source.m_Depth, source.m_Format);
+    memcpy(m_Data, source.m_Data, GetDataSize());
+}
+
+// Write to a temporary file and rename it over the cache, so an interrupted write never leaves a
+// truncated cache behind.
+bool VarianceCache::Save(uint64_t heightMapHash) const
+{
+    char fileName[64], tempName[80];
+    snprintf(fileName, sizeof(fileName), VARIANCE_CACHE_FILE, MAP_SIZE);
+    snprintf(tempName, sizeof(tempName), "%s.tmp", fileName);
+
+    FILE *fp = fopen(tempName, "wb");
+    if (!fp)
+        return false;
+
+    VarianceCacheHeader header;
+    FillHeader(&header, heightMapHash, m_Depth, m_Format);
+
+    bool ok = fwrite(&header, sizeof(header), 1, fp) == 1 && fwrite(m_Data, 1, GetDataSize(), fp) == GetDataSize();
+    ok = (fclose(fp) == 0) && ok;
+
+#ifdef _WIN32
+    // rename() won't replace an existing file here.
+    if (ok)
+        remove(fileName);
+#endif
+
+    if (!ok || rename(tempName, fileName) != 0)
+    {
+        remove(tempName);
+        return false;
+    }
+
+    return true;
+}
+
+void VarianceCache::Release()
+{
+    if (m_Mapping)
+    {
+#ifdef _WIN32
+        free(m_Mapping);
+#else
+        munmap(m_Mapping, m_MappingSize);
+#endif
+    } else
+        free(m_Data);
+
+    m_Data = nullptr;
+    m_Mapping = nullptr;
+    m_MappingSize = 0;
+}
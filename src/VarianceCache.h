@@ -0,0 +1,105 @@
+//  VarianceCache.h
+//  Bryan Turner (original version), Rodrigo Verdiani (SDL version)
+//
+//  Parts of the code in this file were borrowed from numerous public sources &
+//  literature.  I reserve NO rights to this code and give a hearty thank-you to all the
+//  excellent sources used in this project.  These include, but are not limited to:
+//
+//  Longbow Digital Arts Programming Forum (www.LongbowDigitalArts.com)
+//  Gamasutra Features (www.Gamasutra.com)
+//  GameDev References (www.GameDev.net)
+//  C. Cookson's ROAM implementation (C.J.Cookson@dcs.warwick.ac.uk OR cjcookson@hotmail.com)
+//  OpenGL Super Bible (Waite Group Press)
+//  And many more...
+
+#ifndef VARIANCECACHE_H
+#define VARIANCECACHE_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include "Patch.h"
+
+// Name of the cache file for a map size (in the working directory, next to the height map).
+#define VARIANCE_CACHE_FILE "Variance%d.cache"
+
+// Bump when the layout of the file or the variance computation changes.
+#define VARIANCE_CACHE_VERSION 2
+
+// VarianceCacheHeader Struct
+// Start of a cache file.  The variance trees follow: left then right tree of every patch, row by row.
+struct VarianceCacheHeader
+{
+    char Magic[4];                                                // "RVAR"
+    uint32_t Version;                                            // VARIANCE_CACHE_VERSION
+    uint32_t MapSize;                                            // MAP_SIZE
+    uint32_t PatchSize;                                            // PATCH_SIZE
+    uint32_t VarianceDepth;                                        // Depth of the trees
+    uint32_t VarianceFormat;                                    // VARIANCE_FORMATS
+    uint64_t HeightMapHash;                                        // HashHeightMap() of the map the trees were built from
+};
+
+// VarianceCache Class
+// Storage for the variance trees of all the patches of a Landscape.  It is either mapped from a cache file
+// written by an earlier run (copy on write, so deforming the terrain never touches the file) or allocated
+// and filled by Landscape::ComputeVariance(), then saved for the next run.
+class VarianceCache
+{
+protected:
+    unsigned char *m_Data;                                        // Start of the variance trees
+    void *m_Mapping;                                            // Whole mapped file (nullptr if allocated)
+    size_t m_MappingSize;
+    int m_Depth;                                                // Depth of the trees
+    int m_Format;                                                // VARIANCE_FORMATS of the trees
+
+public:
+    VarianceCache();
+    ~VarianceCache();
+
+    VarianceCache(const VarianceCache &) = delete;
+    VarianceCache &operator=(const VarianceCache &) = delete;
+
+    // Hash of the MAP_SIZE x MAP_SIZE height map.
+    static uint64_t HashHeightMap(const unsigned char *hMap);
+
+    // Map the cache file.  Fails (leaving nothing mapped) if it is missing, truncated, or was
+    // built for another map size, patch size, variance depth or format, or height map.
+    bool Load(uint64_t heightMapHash, int depth, int format);
+
+    // Allocate empty trees, to be computed.
+    void Allocate(int depth, int format);
+
+    // Allocate a private copy of another cache's trees.
+    void Copy(const VarianceCache &source);
+
+    // Write the trees to the cache file.
+    bool Save(uint64_t heightMapHash) const;
+
+    void Release();
+
+    bool IsMapped() const
+    {
+        return m_Mapping != nullptr;
+    }
+
+    int GetDepth() const
+    {
+        return m_Depth;
+    }
+
+    int GetFormat() const
+    {
+        return m_Format;
+    }
+
+    VarianceTree GetVarianceLeft(int patchIndex);
+    VarianceTree GetVarianceRight(int patchIndex);
+
+    // Bytes taken by the trees of all the patches.
+    size_t GetDataSize() const;
+
+    // Bytes taken by one variance tree.
+    size_t GetTreeSize() const;
+};
+
+#endif